@@ -1,17 +1,25 @@
+#include <unistd.h>
+
+#include <cerrno>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <future>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "3rd-party/CLI11.hpp"
 #include "slimt/Frontend.hh"
+#include "slimt/Metrics.hh"
 #include "slimt/Model.hh"
 #include "slimt/Response.hh"
+#include "slimt/Trace.hh"
 #include "slimt/Types.hh"
 
 inline std::string read_from_stdin() {
@@ -22,6 +30,24 @@ inline std::string read_from_stdin() {
   return input;
 }
 
+inline void read_from_stdin(slimt::Stream &stream) {
+  // Forward whatever a pipe has as soon as it has it, instead of waiting to
+  // fill a buffer as stdio would.
+  constexpr size_t kBufferSize = 64 * 1024;
+  std::vector<char> buffer(kBufferSize);
+  while (true) {
+    ssize_t count = read(STDIN_FILENO, buffer.data(), buffer.size());
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    stream.write(std::string_view(buffer.data(), count));
+  }
+  stream.close();
+}
+
 struct Options {
   std::string root;
   slimt::Package<std::string> translator;
@@ -29,12 +55,18 @@ struct Options {
   std::string follow_root;
   slimt::Package<std::string> follow;
   size_t poll = 5;  // NOLINT
+  std::string memory;
+  std::string metrics;
+  std::string trace;
+  size_t window = slimt::Blocking::kWindow;
 
   slimt::Config service;
   slimt::Model::Config model;
 
   bool async = false;
   bool html = false;
+  bool lines = false;
+  bool stream = false;
   bool version = false;
 
   template <class App>
@@ -53,9 +85,15 @@ struct Options {
     app.add_option("--follow-ssplit", follow.ssplit, "Path to ssplit prefixes file.");
 
     app.add_option("--poll", poll, "Seconds to poll a long request to report");
+    app.add_option("--metrics", metrics, "File to write per-stage latency, and per-batch occupancy and words per second histograms to on exit, in Prometheus text format. - for stderr.");
+    app.add_option("--trace", trace, "File to write a timeline of batches, decoder steps and multiplies to, as Chrome trace-event JSON.");
+    app.add_option("--translation-memory", memory, "Tab-separated source and target segments to add to --cache-file at startup.");
     app.add_flag("--version", version, "Display version");
     app.add_flag("--html", html, "Whether content is HTML");
     app.add_flag("--async", async, "Try async backend");
+    app.add_flag("--lines", lines, "Translate each line of input on its own, writing translations in order as they complete");
+    app.add_flag("--stream", stream, "Translate text from a pipe as it arrives, writing translations as sentences complete");
+    app.add_option("--window", window, "Lines held in flight at most with --lines");
 
     service.setup_onto(app);
     model.setup_onto(app);
@@ -102,9 +140,72 @@ void run(const Options &options) {
         options.model, package(options.follow_root, options.follow));
   }
 
-  if (options.async) {
+  // Seeds the cache file of service with the translation memory, if given.
+  auto preload = [&options, &model](auto &service) {
+    if (!options.memory.empty()) {
+      size_t added = service.preload(model, options.memory);
+      fprintf(stderr, "Preloaded %zu segments from %s\n", added,
+              options.memory.c_str());
+    }
+  };
+
+  if (!options.trace.empty()) {
+    Tracer::instance().start();
+  }
+
+  if (options.lines) {
+    // Line operation, for corpora too large to hold: each line translates
+    // on its own, and is written as soon as those before it are.
+    if (follow) {
+      fprintf(stderr, "--lines does not support pivoting.\n");
+      std::exit(EXIT_FAILURE);
+    }
+
+    Blocking service(options.service);
+    preload(service);
+
+    slimt::Options opts{
+        .alignment = false,   //
+        .html = options.html  //
+    };
+
+    auto read = [](std::string &source) {
+      return static_cast<bool>(std::getline(std::cin, source));
+    };
+
+    auto write = [](Response &&response) {
+      fprintf(stdout, "%s\n", response.target.text.c_str());
+    };
+
+    service.translate(model, read, write, opts, options.window);
+    fflush(stdout);
+  } else if (options.stream) {
+    // Streaming operation, translating text from a pipe as it arrives.
+    if (options.html) {
+      fprintf(stderr, "--stream does not support HTML.\n");
+      std::exit(EXIT_FAILURE);
+    }
+
+    Async service(options.service);
+    preload(service);
+
+    slimt::Options opts{
+        .alignment = true,  //
+        .html = false       //
+    };
+
+    auto print = [](Response &&response) {
+      fprintf(stdout, "%s", response.target.text.c_str());
+      fflush(stdout);
+    };
+
+    Stream stream(service, model, follow, opts, print);
+    read_from_stdin(stream);
+    fprintf(stdout, "\n");
+  } else if (options.async) {
     // Async operation.
     Async service(options.service);
+    preload(service);
 
     std::string source = read_from_stdin();
     slimt::Options opts{
@@ -170,6 +271,7 @@ void run(const Options &options) {
   } else {
     // Blocking operation.
     Blocking service(options.service);
+    preload(service);
 
     std::string source = read_from_stdin();
     slimt::Options opts{
@@ -181,7 +283,19 @@ void run(const Options &options) {
     fprintf(stdout, "%s\n", responses[0].target.text.c_str());
   }
 
-  // fprintf(stdout, "wps: %f\n", wps.value());
+  if (!options.trace.empty() && !Tracer::instance().stop(options.trace)) {
+    fprintf(stderr, "Failed to write trace to %s\n", options.trace.c_str());
+  }
+
+  if (!options.metrics.empty()) {
+    std::string metrics = Metrics::instance().prometheus();
+    if (options.metrics == "-") {
+      fprintf(stderr, "%s", metrics.c_str());
+    } else {
+      std::ofstream out(options.metrics);
+      out << metrics;
+    }
+  }
 }
 
 int main(int argc, char *argv[]) {
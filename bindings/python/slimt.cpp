@@ -5,8 +5,12 @@
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <vector>
 
 namespace py = pybind11;
@@ -18,15 +22,27 @@ using slimt::Alignment;
 using slimt::Alignments;
 using slimt::AnnotatedText;
 using ServiceConfig = slimt::Config;
+using slimt::BatchController;
+using slimt::Blocking;
 using ModelConfig = slimt::Model::Config;
 using slimt::Encoding;
+using slimt::Histogram;
+using slimt::Measure;
+using slimt::Metrics;
 using slimt::Options;
+using slimt::Partial;
 using slimt::Range;
 using slimt::Response;
+using slimt::Stage;
+using slimt::Tracer;
+using slimt::Stream;
+using slimt::TranslationCache;
 
 using Package = slimt::Package<std::string>;
 using Service = slimt::Async;
 using Model = slimt::Model;
+using Registry = slimt::ModelRegistry;
+using slimt::Vocabulary;
 
 PYBIND11_MAKE_OPAQUE(std::vector<Response>);
 PYBIND11_MAKE_OPAQUE(std::vector<std::string>);
@@ -49,10 +65,14 @@ class PyService {
     // slimt::setThrowExceptionOnAbort(true);
   }
 
+  explicit PyService(const ServiceConfig &config)
+      : service_(make_service(config)) {}
+
+  Service &service() { return service_; }
+
   std::vector<Response> translate(std::shared_ptr<Model> model, py::list &texts,
-                                  bool html,
-                                  Encoding encoding = Encoding::UTF8) {
-    py::call_guard<py::gil_scoped_release> gil_guard;
+                                  bool html, Encoding encoding,
+                                  const std::optional<Options> &given) {
     Redirect redirect;
 
     std::vector<std::string> sources;
@@ -60,15 +80,19 @@ class PyService {
       sources.push_back(py::str(handle));
     }
 
+    Options options = given.value_or(Options{
+        .html = html,  //
+    });
+
+    // Callbacks in options take the GIL on worker threads, so it cannot be
+    // held while waiting on them.
+    py::gil_scoped_release release;
+
     // Prepare promises, save respective futures. Have callback's in async set
     // value to the promises.
     using Handle = slimt::Handle;
     std::vector<Handle> handles;
 
-    Options options{
-        .html = html,  //
-    };
-
     for (auto &source : sources) {
       Handle handle = service_.translate(model, std::move(source), options);
       handles.push_back(std::move(handle));
@@ -138,9 +162,117 @@ class PyService {
     return Service(config);
   }
 
+  static Service make_service(const ServiceConfig &config) {
+    Redirect redirect;
+    py::call_guard<py::gil_scoped_release> gil_guard;
+    return Service(config);
+  }
+
   Service service_;
 };
 
+class PyBlocking {
+ public:
+  explicit PyBlocking(const ServiceConfig &config) : blocking_(config) {}
+
+  std::vector<Response> translate(const std::shared_ptr<Model> &model,
+                                  py::list &texts, bool html,
+                                  const std::optional<Options> &given) {
+    Redirect redirect;
+    std::vector<std::string> sources = from_list(texts);
+    Options options = given.value_or(Options{
+        .html = html,  //
+    });
+
+    py::gil_scoped_release release;
+    return blocking_.translate(model, std::move(sources), options);
+  }
+
+  // Reads sources from an iterable and hands each Response to write in the
+  // same order, both on the calling thread, taking the GIL for each.
+  size_t translate_iter(const std::shared_ptr<Model> &model,
+                        const py::iterable &sources, const py::function &write,
+                        const std::optional<Options> &given, size_t window) {
+    Redirect redirect;
+    py::iterator iterator = py::iter(sources);
+    auto reader = [&iterator](std::string &source) {
+      py::gil_scoped_acquire acquire;
+      if (iterator == py::iterator::sentinel()) {
+        return false;
+      }
+      source = py::str(*iterator);
+      ++iterator;
+      return true;
+    };
+
+    auto writer = [&write](Response &&response) {
+      py::gil_scoped_acquire acquire;
+      write(std::move(response));
+    };
+
+    Options options = given.value_or(Options{});
+    py::gil_scoped_release release;
+    return blocking_.translate(model, reader, writer, options, window);
+  }
+
+  std::vector<Response> pivot(const std::shared_ptr<Model> &first,
+                              const std::shared_ptr<Model> &second,
+                              py::list &texts, bool html) {
+    Redirect redirect;
+    std::vector<std::string> sources = from_list(texts);
+    Options options{
+        .html = html  //
+    };
+
+    py::gil_scoped_release release;
+    return blocking_.pivot(first, second, std::move(sources), options);
+  }
+
+  BatchController::State batching(const std::shared_ptr<Model> &model) const {
+    return blocking_.batching(model);
+  }
+
+ private:
+  static std::vector<std::string> from_list(py::list &texts) {
+    std::vector<std::string> sources;
+    for (auto handle : texts) {
+      sources.push_back(py::str(handle));
+    }
+    return sources;
+  }
+
+  Blocking blocking_;
+};
+
+// Destroying a Stream closes it, which waits on callbacks that take the GIL.
+// The callback itself is a Python object, so goes with the GIL held.
+struct ReleaseStream {
+  void operator()(Stream *stream) const {
+    {
+      py::gil_scoped_release release;
+      stream->close();
+    }
+    delete stream;
+  }
+};
+
+using PyStream = std::unique_ptr<Stream, ReleaseStream>;
+
+// Wraps a Python callable for C++ to call, copy and release on any thread,
+// taking the GIL for each.
+template <class... Args>
+std::function<void(Args...)> from_python(py::function function) {
+  std::shared_ptr<py::function> held(new py::function(std::move(function)),
+                                     [](py::function *function) {
+                                       py::gil_scoped_acquire acquire;
+                                       delete function;
+                                     });
+  return [held](Args... args) {
+    py::gil_scoped_acquire acquire;
+    (*held)(std::forward<Args>(args)...);
+  };
+}
+
 PYBIND11_MODULE(_slimt, m) {
   m.doc() = "slimt python bindings";
   m.attr("__version__") = slimt::version();
@@ -192,27 +324,287 @@ PYBIND11_MODULE(_slimt, m) {
       .def_readwrite("decoder_layers", &ModelConfig::decoder_layers)
       .def_readwrite("feed_forward_depth", &ModelConfig::feed_forward_depth)
       .def_readwrite("num_heads", &ModelConfig::num_heads)
-      .def_readwrite("split_mode", &ModelConfig::split_mode);
+      .def_readwrite("split_mode", &ModelConfig::split_mode)
+      .def_readwrite("shared_weights", &ModelConfig::shared_weights)
+      .def_readwrite("shortlist_group_size",
+                     &ModelConfig::shortlist_group_size);
 
   py::enum_<Encoding>(m, "Encoding")
       .value("Byte", Encoding::Byte)
       .value("UTF8", Encoding::UTF8)
       .export_values();
 
+  py::class_<ServiceConfig>(m, "ServiceConfig")
+      .def(py::init<>())
+      .def_readwrite("max_words", &ServiceConfig::max_words)
+      .def_readwrite("cache_size", &ServiceConfig::cache_size)
+      .def_readwrite("cache_file", &ServiceConfig::cache_file)
+      .def_readwrite("workers", &ServiceConfig::workers)
+      .def_readwrite("tgt_length_limit_factor",
+                     &ServiceConfig::tgt_length_limit_factor)
+      .def_readwrite("wrap_length", &ServiceConfig::wrap_length)
+      .def_readwrite("preprocess_workers", &ServiceConfig::preprocess_workers)
+      .def_readwrite("target_latency", &ServiceConfig::target_latency)
+      .def_readwrite("continuous", &ServiceConfig::continuous)
+      .def_readwrite("pin", &ServiceConfig::pin)
+      .def_readwrite("replicate", &ServiceConfig::replicate);
+
+  py::class_<BatchController::State>(m, "BatchingState")
+      .def_readonly("budget", &BatchController::State::budget)
+      .def_readonly("latency", &BatchController::State::latency)
+      .def_readonly("token_latency", &BatchController::State::token_latency)
+      .def_readonly("batches", &BatchController::State::batches);
+
+  py::class_<TranslationCache::Stats>(m, "CacheStats")
+      .def_readonly("hits", &TranslationCache::Stats::hits)
+      .def_readonly("misses", &TranslationCache::Stats::misses)
+      .def_readonly("evictions", &TranslationCache::Stats::evictions)
+      .def_readonly("conflicts", &TranslationCache::Stats::conflicts);
+
+  py::class_<Partial>(m, "Partial")
+      .def_readonly("index", &Partial::index)
+      .def_readonly("source", &Partial::source)
+      .def_readonly("target", &Partial::target)
+      .def_readonly("alignment", &Partial::alignment);
+
+  py::class_<Options>(m, "Options")
+      .def(py::init<>([](bool alignment, bool html, size_t priority,
+                         size_t deadline, std::optional<py::function> partial) {
+             Options options{
+                 .alignment = alignment,  //
+                 .html = html,            //
+                 .priority = priority,    //
+                 .deadline = deadline     //
+             };
+             if (partial) {
+               options.partial = from_python<Partial &&>(std::move(*partial));
+             }
+             return options;
+           }),
+           py::arg("alignment") = false, py::arg("html") = false,
+           py::arg("priority") = 0, py::arg("deadline") = 0,
+           py::arg("partial") = py::none())
+      .def_readwrite("alignment", &Options::alignment)
+      .def_readwrite("html", &Options::html)
+      .def_readwrite("priority", &Options::priority)
+      .def_readwrite("deadline", &Options::deadline);
+
   py::class_<PyService>(m, "Service")
       .def(py::init<size_t, size_t>(), py::arg("workers") = 1,
            py::arg("cache_size") = 0)
+      .def(py::init<const ServiceConfig &>(), py::arg("config"))
       .def("translate", &PyService::translate, py::arg("model"),
            py::arg("texts"), py::arg("html") = false,
-           py::arg("encoding") = Encoding::UTF8)
+           py::arg("encoding") = Encoding::UTF8,
+           py::arg("options") = py::none())
       .def("pivot", &PyService::pivot, py::arg("first"), py::arg("second"),
-           py::arg("texts"), py::arg("html") = false);
+           py::arg("texts"), py::arg("html") = false)
+      .def("batching",
+           [](PyService &service) { return service.service().batching(); })
+      .def("caching",
+           [](PyService &service) { return service.service().caching(); })
+      .def(
+          "preload",
+          [](PyService &service, const std::shared_ptr<Model> &model,
+             const std::string &tsv) {
+            return service.service().preload(model, tsv);
+          },
+          py::arg("model"), py::arg("tsv"),
+          py::call_guard<py::gil_scoped_release>())
+      .def(
+          "compact",
+          [](PyService &service) { service.service().compact(); },
+          py::call_guard<py::gil_scoped_release>());
+
+  // Translates on the calling thread and config.workers - 1 more. translate
+  // returns once everything is translated, translate_iter writes each
+  // Response as soon as those before it are.
+  py::class_<PyBlocking>(m, "Blocking")
+      .def(py::init<const ServiceConfig &>(), py::arg("config"))
+      .def("translate", &PyBlocking::translate, py::arg("model"),
+           py::arg("texts"), py::arg("html") = false,
+           py::arg("options") = py::none())
+      .def("translate_iter", &PyBlocking::translate_iter, py::arg("model"),
+           py::arg("sources"), py::arg("write"),
+           py::arg("options") = py::none(),
+           py::arg("window") = Blocking::kWindow)
+      .def("pivot", &PyBlocking::pivot, py::arg("first"), py::arg("second"),
+           py::arg("texts"), py::arg("html") = false)
+      .def("batching", &PyBlocking::batching, py::arg("model"));
+
+  // Responses are handed to callback on worker threads, which take the GIL
+  // for it. Writing, closing and destroying release the GIL, as each may wait
+  // on those.
+  py::class_<Stream, PyStream>(m, "Stream")
+      .def(py::init<>([](PyService &service,
+                         const std::shared_ptr<Model> &model,
+                         const py::function &callback,
+                         const std::shared_ptr<Model> &follow) {
+             auto deliver = [callback](Response &&response) {
+               py::gil_scoped_acquire acquire;
+               callback(std::move(response));
+             };
+             return PyStream(new Stream(service.service(), model, follow,
+                                        Options{}, std::move(deliver)));
+           }),
+           py::arg("service"), py::arg("model"), py::arg("callback"),
+           py::arg("follow") = nullptr, py::keep_alive<1, 2>())
+      .def("write", &Stream::write, py::arg("text"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("close", &Stream::close, py::call_guard<py::gil_scoped_release>());
 
   py::class_<Model, std::shared_ptr<Model>>(m, "Model")
       .def(py::init<>([](const ModelConfig &config, const Package &package) {
              return std::make_shared<Model>(config, package);
            }),
-           py::arg("config"), py::arg("package"));
+           py::arg("config"), py::arg("package"))
+      .def_property_readonly("id", &Model::id)
+      .def_property_readonly("vocabulary", &Model::vocabulary,
+                             py::return_value_policy::reference_internal)
+      .def(
+          "shortlist",
+          [](const Model &model,
+             const slimt::Words &words) -> std::optional<slimt::Words> {
+            const auto &generator = model.shortlist_generator();
+            if (!generator) {
+              return std::nullopt;
+            }
+            return generator->generate(words).words();
+          },
+          py::arg("words"))
+      .def(
+          "shortlists",
+          [](const Model &model, const std::vector<slimt::Words> &sentences,
+             size_t group_size) -> std::optional<std::vector<slimt::Words>> {
+            const auto &generator = model.shortlist_generator();
+            if (!generator) {
+              return std::nullopt;
+            }
+            slimt::Words words;
+            std::vector<size_t> lengths;
+            for (const slimt::Words &sentence : sentences) {
+              words.insert(words.end(), sentence.begin(), sentence.end());
+              lengths.push_back(sentence.size());
+            }
+            std::vector<slimt::Words> shortlists;
+            for (const auto &shortlist :
+                 generator->generate(words, lengths, group_size)) {
+              shortlists.push_back(shortlist.words());
+            }
+            return shortlists;
+          },
+          py::arg("sentences"), py::arg("group_size"));
+
+  // Encodings come back as (id, begin, end) with offsets into line, so that
+  // memoized and plain encodings compare directly.
+  using Encoded = std::vector<std::tuple<slimt::Word, size_t, size_t>>;
+  auto encoded = [](const std::string &line, const slimt::Words &words,
+                    const slimt::Views &views) {
+    Encoded pieces;
+    for (size_t i = 0; i < words.size(); i++) {
+      size_t begin = views[i].data() - line.data();
+      pieces.emplace_back(words[i], begin, begin + views[i].size());
+    }
+    return pieces;
+  };
+
+  // Decodings come back as text and the (begin, end) offsets into it of each
+  // word.
+  using Spans = std::vector<std::tuple<size_t, size_t>>;
+  auto decoded = [](const std::string &text, const slimt::Views &views) {
+    Spans spans;
+    for (const auto &view : views) {
+      size_t begin = view.data() - text.data();
+      spans.emplace_back(begin, begin + view.size());
+    }
+    return std::make_tuple(text, std::move(spans));
+  };
+
+  py::class_<Vocabulary>(m, "Vocabulary")
+      .def("__len__", &Vocabulary::size)
+      .def("memoizes", &Vocabulary::memoizes)
+      .def("encode",
+           [encoded](const Vocabulary &vocabulary, const std::string &line) {
+             slimt::Words words;
+             slimt::Views views;
+             vocabulary.encode(line, words, views);
+             return encoded(line, words, views);
+           })
+      .def("encode_pieces",
+           [encoded](const Vocabulary &vocabulary, const std::string &line) {
+             slimt::Words words;
+             slimt::Views views;
+             vocabulary.encode_pieces(line, words, views);
+             return encoded(line, words, views);
+           })
+      .def("decodes_flat", &Vocabulary::decodes_flat)
+      .def("decode",
+           [decoded](const Vocabulary &vocabulary, const slimt::Words &words) {
+             std::string text;
+             slimt::Views views =
+                 vocabulary.decode(words, text, /*ignore_eos=*/false);
+             return decoded(text, views);
+           })
+      .def("decode_pieces",
+           [decoded](const Vocabulary &vocabulary, const slimt::Words &words) {
+             std::string text;
+             slimt::Views views = vocabulary.decode_pieces(words, text);
+             return decoded(text, views);
+           });
+
+  py::class_<Registry>(m, "Registry")
+      .def(py::init<size_t>(), py::arg("budget") = 0)
+      .def("acquire", &Registry::acquire, py::arg("config"),
+           py::arg("package"), py::call_guard<py::gil_scoped_release>())
+      .def("collect", &Registry::collect)
+      .def("resident", &Registry::resident)
+      .def("__len__", &Registry::size);
+
+  py::enum_<Stage>(m, "Stage")
+      .value("Queue", Stage::kQueue)
+      .value("Preprocess", Stage::kPreprocess)
+      .value("Shortlist", Stage::kShortlist)
+      .value("Encode", Stage::kEncode)
+      .value("DecodeStep", Stage::kDecodeStep)
+      .value("Detokenize", Stage::kDetokenize)
+      .value("HTML", Stage::kHTML)
+      .value("CacheHit", Stage::kCacheHit);
+
+  py::enum_<Measure>(m, "Measure")
+      .value("Occupancy", Measure::kOccupancy)
+      .value("WordsPerSecond", Measure::kWordsPerSecond);
+
+  py::class_<Histogram::Snapshot>(m, "Histogram")
+      .def_readonly("counts", &Histogram::Snapshot::counts)
+      .def_readonly("count", &Histogram::Snapshot::count)
+      .def_readonly("sum", &Histogram::Snapshot::sum)
+      .def("quantile", &Histogram::Snapshot::quantile, py::arg("q"))
+      .def_property_readonly("bounds", [](const Histogram::Snapshot &self) {
+        std::vector<double> bounds;
+        for (size_t i = 0; i < Histogram::kBuckets; i++) {
+          bounds.push_back(Histogram::bound(self.scale, i));
+        }
+        return bounds;
+      });
+
+  auto sm_metrics = m.def_submodule("metrics");
+  sm_metrics.def("snapshot", [](Stage stage) {
+    return Metrics::instance()[stage].snapshot();
+  });
+  sm_metrics.def("snapshot", [](Measure measure) {
+    return Metrics::instance()[measure].snapshot();
+  });
+  sm_metrics.def("prometheus",
+                 []() { return Metrics::instance().prometheus(); });
+  sm_metrics.def("reset", []() { Metrics::instance().reset(); });
+
+  auto sm_trace = m.def_submodule("trace");
+  sm_trace.def("start", []() { Tracer::instance().start(); });
+  sm_trace.def(
+      "stop",
+      [](const std::string &path) { return Tracer::instance().stop(path); },
+      py::arg("path"));
+  sm_trace.def("buffered", []() { return Tracer::instance().buffered(); });
 
   auto sm_preset = m.def_submodule("preset");
   sm_preset.def("tiny", &slimt::preset::tiny);
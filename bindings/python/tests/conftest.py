@@ -12,10 +12,10 @@ def service():
 
 
 @pytest.fixture(scope="session")
-def models():
+def packages():
     keys = ["browsermt"]
     model_ids = ["en-es-tiny", "es-en-tiny"]
-    models_ = []
+    packages_ = []
 
     for repository in keys:
         for model_id in model_ids:
@@ -33,9 +33,17 @@ def models():
                 vocabulary=os.path.join(root, c["vocabs"][0]),
                 shortlist=os.path.join(root, c["shortlist"][0]),
             )
-            config = Config()
-            model = Model(config, package)
-            models_.append(model)
+            packages_.append(package)
+    yield packages_
+
+
+@pytest.fixture(scope="session")
+def models(packages):
+    models_ = []
+    for package in packages:
+        config = Config()
+        model = Model(config, package)
+        models_.append(model)
     yield models_
 
 
@@ -0,0 +1,73 @@
+# type: ignore
+from slimt import Blocking, ServiceConfig
+
+SOURCES = [
+    f"This is sentence number {i}. The weather is nice today." for i in range(40)
+]
+
+
+def make_blocking(workers):
+    config = ServiceConfig()
+    config.workers = workers
+    config.cache_size = 0
+    # Small batches, so that there are several to spread across workers.
+    config.max_words = 64
+    return Blocking(config)
+
+
+def targets(responses):
+    return [response.target.text for response in responses]
+
+
+def test_blocking_workers(models):
+    model = models[0]
+    alone = make_blocking(1).translate(model, SOURCES)
+
+    blocking = make_blocking(4)
+    shared = blocking.translate(model, SOURCES)
+
+    # In the order of sources, and as translated on a single thread.
+    assert [response.source.text for response in shared] == SOURCES
+    assert targets(shared) == targets(alone)
+    assert blocking.batching(model).batches > 1
+
+
+def test_blocking_pivot(models):
+    first, second = models
+    blocking = make_blocking(3)
+    pivoted = blocking.pivot(first, second, SOURCES)
+
+    pivots = blocking.translate(first, SOURCES)
+    through = blocking.translate(second, targets(pivots))
+    assert [response.source.text for response in pivoted] == SOURCES
+    assert targets(pivoted) == targets(through)
+
+    # Each Model adapts batch size of its own.
+    assert blocking.batching(first).batches > 0
+    assert blocking.batching(second).batches > 0
+
+
+def test_blocking_window(models):
+    model = models[0]
+    blocking = make_blocking(2)
+    window = 3
+    read = 0
+    written = []
+
+    def sources():
+        nonlocal read
+        for source in SOURCES:
+            read += 1
+            yield source
+
+    def write(response):
+        # No more than window sources are held at any time.
+        assert read - len(written) <= window
+        written.append(response)
+
+    count = blocking.translate_iter(model, sources(), write, window=window)
+    assert count == len(SOURCES)
+
+    # In the order read, as translated all at once.
+    assert [response.source.text for response in written] == SOURCES
+    assert targets(written) == targets(blocking.translate(model, SOURCES))
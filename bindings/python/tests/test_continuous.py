@@ -0,0 +1,35 @@
+# type: ignore
+from slimt import Service, ServiceConfig
+
+SOURCES = [
+    "How embarrassing. A fridge full of condiments and no food.",
+    "The weather is nice today.",
+    "1 2 3 4 5 6 7 8 9",
+    "Can you help me out with some things? It has been a long time.",
+    "Short.",
+] * 8
+
+
+def make_service(continuous):
+    config = ServiceConfig()
+    config.workers = 2
+    config.cache_size = 0
+    config.continuous = continuous
+    # Small batches, so that sentences join and leave a live batch as others
+    # complete.
+    config.max_words = 64
+    return Service(config)
+
+
+def test_continuous(models):
+    model = models[0]
+    batched = make_service(False).translate(model, SOURCES)
+    service = make_service(True)
+    continuous = service.translate(model, SOURCES)
+
+    # Decoding across batches that change between steps leaves translations
+    # as they are.
+    assert [r.target.text for r in continuous] == [r.target.text for r in batched]
+
+    # Batch size adaptation sees continuous decoding too.
+    assert service.batching().batches > 0
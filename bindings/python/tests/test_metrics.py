@@ -0,0 +1,39 @@
+# type: ignore
+from slimt import Measure, Stage, metrics
+
+
+def test_metrics(service, models, sample):
+    source, _, html = sample
+    metrics.reset()
+    service.translate(models[0], [source], html=html)
+
+    for stage in [Stage.Preprocess, Stage.Encode, Stage.DecodeStep]:
+        histogram = metrics.snapshot(stage)
+        assert histogram.count > 0
+        assert sum(histogram.counts) == histogram.count
+        assert 0 <= histogram.quantile(0.5) <= histogram.quantile(0.99)
+
+    assert "slimt_encode_seconds_count" in metrics.prometheus()
+
+
+def test_measures(service, models, sample):
+    source, _, html = sample
+    metrics.reset()
+    service.translate(models[0], [source], html=html)
+
+    # One recording of each per batch translated.
+    occupancy = metrics.snapshot(Measure.Occupancy)
+    wps = metrics.snapshot(Measure.WordsPerSecond)
+    assert occupancy.count > 0
+    assert wps.count == occupancy.count
+
+    # Padding leaves some of a batch to words, never more than all of it.
+    assert occupancy.bounds[0] == 0 and occupancy.bounds[-1] == 1
+    assert occupancy.counts[0] == 0 and occupancy.counts[-1] == 0
+    assert 0 < occupancy.sum <= occupancy.count
+    assert 0 < occupancy.quantile(0.5) <= 1
+    assert wps.sum > 0 and wps.quantile(0.5) > 0
+
+    dump = metrics.prometheus()
+    assert f"slimt_batch_occupancy_ratio_count {occupancy.count}" in dump
+    assert f"slimt_batch_words_per_second_count {wps.count}" in dump
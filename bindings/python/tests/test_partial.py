@@ -0,0 +1,31 @@
+# type: ignore
+from slimt import Options
+
+SOURCE = (
+    "How embarrassing. A fridge full of condiments and no food. "
+    "The weather is nice today.\nCan you help me out with some things?"
+)
+
+
+def test_partial(service, models):
+    model = models[0]
+    partials = []
+    options = Options(partial=lambda partial: partials.append(partial))
+    response = service.translate(model, [SOURCE], options=options)[0]
+
+    # Every sentence is reported once, in order.
+    count = response.source.sentence_count()
+    assert [partial.index for partial in partials] == list(range(count))
+
+    # Each as it ends up in the response. Text is ASCII, so bytes are
+    # characters.
+    for i, partial in enumerate(partials):
+        source = response.source.sentence_as_range(i)
+        assert (partial.source.begin, partial.source.end) == (
+            source.begin,
+            source.end,
+        )
+
+        target = response.target.sentence_as_range(i)
+        expected = response.target.text[target.begin : target.end]
+        assert partial.target.strip() == expected.strip()
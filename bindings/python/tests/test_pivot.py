@@ -43,3 +43,27 @@ def test_pivot(service, models, sample):
     sources_response = responses_[0]["source"]
     target_response = responses_[-1]["target"]
     assert jaccard_similarity(sources_response, target_response) >= 0.3
+
+
+HANDOFF = [
+    "The weather is nice today.",
+    "How embarrassing. A fridge full of condiments and no food.",
+    "Can you help me out with some things?",
+]
+
+
+@pytest.mark.parametrize("source", HANDOFF)
+def test_pivot_handoff(service, models, source):
+    # The Models share a vocabulary, so pivoting hands the words decoded by the
+    # first straight to the second. Going through text instead re-tokenizes
+    # the pivot, which for these comes out the same words.
+    first, second = models
+    pivot = service.translate(first, [source])[0]
+    through_text = service.translate(second, [pivot.target.text])[0]
+
+    handed_off = service.pivot(first, second, [source])[0]
+    assert handed_off.source.text == source
+    assert handed_off.target.text == through_text.target.text
+    assert (
+        handed_off.target.sentence_count() == through_text.target.sentence_count()
+    )
@@ -0,0 +1,83 @@
+# type: ignore
+import gc
+from concurrent.futures import ThreadPoolExecutor
+from slimt import Config, Registry, Service, ServiceConfig
+
+
+def test_registry_dedup(packages):
+    registry = Registry()
+    a = registry.acquire(Config(), packages[0])
+    b = registry.acquire(Config(), packages[0])
+    assert a is b
+    assert len(registry) == 1
+
+    # A different config interprets the same files differently.
+    config = Config()
+    config.shortlist_group_size = 16
+    c = registry.acquire(config, packages[0])
+    assert c is not a
+    assert len(registry) == 2
+
+
+def test_registry_ids(packages):
+    # Each a distinct Model, loading on threads of its own outside the
+    # registry lock.
+    registry = Registry()
+    keys = []
+    for package in packages:
+        for group_size in [0, 4, 8, 16]:
+            config = Config()
+            config.shortlist_group_size = group_size
+            keys.append((config, package))
+
+    with ThreadPoolExecutor(max_workers=len(keys)) as pool:
+        models = list(pool.map(lambda key: registry.acquire(*key), keys))
+
+    assert len(registry) == len(keys)
+    assert len({model.id for model in models}) == len(keys)
+
+
+def test_registry_idle(packages):
+    registry = Registry(budget=1)
+    held = registry.acquire(Config(), packages[0])
+    registry.acquire(Config(), packages[1])
+    gc.collect()
+
+    # Over budget, but only the Model nobody holds may go.
+    registry.collect()
+    assert len(registry) == 1
+    assert registry.acquire(Config(), packages[0]) is held
+    assert registry.resident() > 0
+
+
+def test_registry_budget(packages):
+    registry = Registry(budget=1)
+    for package in packages:
+        model = registry.acquire(Config(), package)
+        del model
+    gc.collect()
+
+    registry.collect()
+    assert len(registry) == 0
+    assert registry.resident() == 0
+
+
+def test_registry_replicas(packages):
+    config = ServiceConfig()
+    config.workers = 1
+    config.cache_size = 0
+    config.replicate = True
+    service = Service(config)
+    registry = Registry(budget=1)
+
+    model = registry.acquire(Config(), packages[0])
+    assert service.translate(model, ["The weather is nice today."])
+    del model
+    gc.collect()
+
+    # Replicas hold the files mapped, not the Model they came from. A batch
+    # with another Model frees the worker of the first, and drops its replicas.
+    other = registry.acquire(Config(), packages[1])
+    assert service.translate(other, ["The weather is nice today."])
+    registry.collect()
+    assert len(registry) == 1
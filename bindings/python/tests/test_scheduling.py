@@ -0,0 +1,43 @@
+# type: ignore
+import threading
+
+import pytest
+from slimt import Options, Service
+
+# Enough sentences to take several batches at the default max_words, each
+# distinct so that none follows another.
+BULK = [f"This is sentence number {i} of a long document." for i in range(600)]
+
+
+@pytest.mark.parametrize(
+    "urgent",
+    [Options(deadline=1), Options(priority=1)],
+    ids=["deadline", "priority"],
+)
+def test_scheduling(models, urgent):
+    # Without a cache, so that bulk translates in full each time.
+    service = Service(workers=1)
+    model = models[0]
+    bulk = []
+    started = threading.Event()
+
+    def record(partial):
+        bulk.append(partial.index)
+        started.set()
+
+    options = Options(partial=record)
+    source = " ".join(BULK)
+    worker = threading.Thread(
+        target=lambda: service.translate(model, [source], options=options)
+    )
+    worker.start()
+
+    # Submitted once bulk is underway, an urgent request goes ahead of what
+    # remains of it, which is due later.
+    started.wait()
+    service.translate(model, ["Please answer this one first."], options=urgent)
+    done = len(bulk)
+
+    worker.join()
+    assert len(bulk) == len(BULK)
+    assert done < len(BULK)
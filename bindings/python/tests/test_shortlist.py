@@ -0,0 +1,91 @@
+# type: ignore
+import struct
+from slimt import Config, Model, Service, ServiceConfig
+
+LINES = [
+    "A fridge full of condiments and no food.",
+    "The quick brown fox, aged 12, jumped over 3 lazy dogs.",
+    "1 2 3 4 5 6 7 8 9",
+    "Can you help me out with some things?",
+    "The weather is nice today.",
+]
+
+
+def read_shortlist(path):
+    with open(path, "rb") as shortlist_file:
+        blob = shortlist_file.read()
+    _, _, frequent, _, offsets_size, shortlist_size = struct.unpack_from("<6Q", blob)
+    offsets = struct.unpack_from(f"<{offsets_size}Q", blob, 48)
+    targets = struct.unpack_from(f"<{shortlist_size}I", blob, 48 + 8 * offsets_size)
+    return frequent, offsets, targets
+
+
+def reference(shortlist, size, words):
+    # As generated from vectors of bools the size of the vocabularies.
+    frequent, offsets, targets = shortlist
+    selected = set(range(min(frequent, size)))
+    for word in set(words):
+        selected.update(targets[offsets[word] : offsets[word + 1]])
+
+    # Padded to a multiple of eight with the least ids not yet selected.
+    padding = frequent
+    while len(selected) % 8 != 0 and padding < size:
+        selected.add(padding)
+        padding += 1
+    return sorted(selected)
+
+
+def words_of(vocabulary, line):
+    return [word for word, _, _ in vocabulary.encode(line)]
+
+
+def test_shortlist(models, packages):
+    for model, package in zip(models, packages):
+        shortlist = read_shortlist(package.shortlist)
+        vocabulary = model.vocabulary
+        size = len(vocabulary)
+
+        # Batches back to back on one thread, the second sharing no more than
+        # common words with the first, so that anything left over from the
+        # first shows.
+        batches = [
+            words_of(vocabulary, LINES[0]) + words_of(vocabulary, LINES[1]),
+            words_of(vocabulary, LINES[2]),
+            words_of(vocabulary, LINES[0]),
+        ]
+        for words in batches:
+            assert model.shortlist(words) == reference(shortlist, size, words)
+
+
+def test_shortlist_groups(models, packages):
+    for model, package in zip(models, packages):
+        shortlist = read_shortlist(package.shortlist)
+        size = len(model.vocabulary)
+        sentences = [words_of(model.vocabulary, line) for line in LINES]
+
+        # Each group covers words of its own sentences, and no others.
+        for group_size in [1, 2, 3]:
+            groups = model.shortlists(sentences, group_size)
+            assert len(groups) == (len(sentences) + group_size - 1) // group_size
+            for i, group in enumerate(groups):
+                words = sum(sentences[i * group_size : (i + 1) * group_size], [])
+                assert group == reference(shortlist, size, words)
+
+
+def test_shortlist_groups_translate(packages):
+    # Grouped one to a shortlist, a sentence decodes as it would in a batch
+    # of its own.
+    config = ServiceConfig()
+    config.workers = 1
+    config.cache_size = 0
+    service = Service(config)
+    model_config = Config()
+    model_config.shortlist_group_size = 1
+    grouped = Model(model_config, packages[0])
+    model = Model(Config(), packages[0])
+
+    translations = service.translate(grouped, LINES)
+    for line, translation in zip(LINES, translations):
+        alone = service.translate(model, [line])[0]
+        assert translation.target.text
+        assert translation.target.text == alone.target.text
@@ -0,0 +1,123 @@
+# type: ignore
+import gc
+
+from slimt import Service, ServiceConfig, Stage, metrics
+
+SOURCES = [
+    "How embarrassing.",
+    "The weather is nice today.",
+    "Can you help me out with some things?",
+]
+
+
+def make_service(path):
+    # Without an in-memory cache, so that every hit is from the store.
+    config = ServiceConfig()
+    config.workers = 1
+    config.cache_size = 0
+    config.cache_file = str(path)
+    return Service(config)
+
+
+def release(service):
+    # Closing the store gives up its lock.
+    del service
+    gc.collect()
+
+
+def targets(responses):
+    return [response.target.text for response in responses]
+
+
+def test_store_reopen(models, tmp_path):
+    model = models[0]
+    path = tmp_path / "store.bin"
+    service = make_service(path)
+    translated = service.translate(model, SOURCES)
+    size = path.stat().st_size
+    release(service)
+
+    metrics.reset()
+    service = make_service(path)
+    found = service.translate(model, SOURCES)
+    assert metrics.snapshot(Stage.CacheHit).count == len(SOURCES)
+    assert targets(found) == targets(translated)
+
+    # Found, so not appended again.
+    assert path.stat().st_size == size
+
+
+def test_store_lock(models, tmp_path):
+    model = models[0]
+    path = tmp_path / "store.bin"
+    writer = make_service(path)
+    writer.translate(model, SOURCES[:1])
+    size = path.stat().st_size
+
+    # Opened while the writer holds it, read-only: finds what was stored,
+    # appends nothing.
+    metrics.reset()
+    reader = make_service(path)
+    reader.translate(model, SOURCES)
+    assert metrics.snapshot(Stage.CacheHit).count == 1
+    assert path.stat().st_size == size
+    release(reader)
+    release(writer)
+
+
+def test_store_compact(models, tmp_path):
+    model = models[0]
+    path = tmp_path / "store.bin"
+    service = make_service(path)
+    translated = service.translate(model, SOURCES)
+    size = path.stat().st_size
+    service.compact()
+    assert path.stat().st_size <= size
+
+    # Still finds everything, whether open across compaction or reopened.
+    metrics.reset()
+    assert targets(service.translate(model, SOURCES)) == targets(translated)
+
+    # The lock passed to the compacted file: others opening it only read,
+    # and the store open across compaction still appends.
+    reader = make_service(path)
+    size = path.stat().st_size
+    reader.translate(model, ["Thank you."])
+    assert path.stat().st_size == size
+    release(reader)
+    service.translate(model, ["Thank you."])
+    assert path.stat().st_size > size
+    release(service)
+    service = make_service(path)
+    assert targets(service.translate(model, SOURCES)) == targets(translated)
+    assert metrics.snapshot(Stage.CacheHit).count == 2 * len(SOURCES)
+
+
+def test_store_preload(models, tmp_path):
+    model = models[0]
+    memory = tmp_path / "memory.tsv"
+    memory.write_text("Hello world.\tHola mundo, desde la memoria.\n")
+    service = make_service(tmp_path / "store.bin")
+
+    assert service.preload(model, str(memory)) == 1
+    response = service.translate(model, ["Hello world."])[0]
+    assert response.target.text == "Hola mundo, desde la memoria."
+
+    # Already stored.
+    assert service.preload(model, str(memory)) == 0
+
+
+def test_store_dedup(models, tmp_path):
+    model = models[0]
+    once = tmp_path / "once.bin"
+    service = make_service(once)
+    single = service.translate(model, [SOURCES[1]])[0]
+    release(service)
+
+    # Repeats translate once, with the rest following, and only the one
+    # translated goes to the store.
+    repeated = tmp_path / "repeated.bin"
+    service = make_service(repeated)
+    responses = service.translate(model, [SOURCES[1]] * 4)
+    assert targets(responses) == [single.target.text] * 4
+    assert repeated.stat().st_size == once.stat().st_size
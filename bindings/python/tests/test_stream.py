@@ -0,0 +1,27 @@
+# type: ignore
+from slimt import Stream
+
+TEXT = (
+    "How embarrassing. A fridge full of condiments and no food.\n"
+    "The weather is nice today.\n"
+    "1 2 3 4 5 6 7 8 9\n"
+)
+
+
+def test_stream(service, models):
+    model = models[0]
+    responses = []
+    stream = Stream(service, model, lambda response: responses.append(response))
+
+    # In pieces small enough that lines arrive over several writes.
+    for i in range(0, len(TEXT), 7):
+        stream.write(TEXT[i : i + 7])
+    stream.close()
+
+    # Everything written is translated once, in order.
+    assert "".join(response.source.text for response in responses) == TEXT
+
+    # Each piece translates as it would on its own.
+    for response in responses:
+        expected = service.translate(model, [response.source.text])[0]
+        assert response.target.text == expected.target.text
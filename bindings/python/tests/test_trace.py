@@ -0,0 +1,89 @@
+# type: ignore
+import json
+
+from slimt import Service, trace
+
+SOURCES = [
+    "How embarrassing. A fridge full of condiments and no food.",
+    "Hello world.",
+    "The quick brown fox jumps over the lazy dog.",
+]
+
+
+def read(path):
+    with open(path) as trace_file:
+        events = json.load(trace_file)["traceEvents"]
+    threads = {
+        event["tid"]: event["args"]["name"] for event in events if event["ph"] == "M"
+    }
+    spans = [event for event in events if event["ph"] == "X"]
+    return threads, spans
+
+
+def within(span, outer):
+    # Timestamps are truncated to a tenth of a microsecond, start and duration
+    # each, so an inner span can appear to end just past its outer.
+    end = span["ts"] + span["dur"]
+    return outer["ts"] <= span["ts"] and end <= outer["ts"] + outer["dur"] + 0.2
+
+
+def test_trace(models, tmp_path):
+    # No cache, so that every source is translated in a batch.
+    service = Service(workers=2, cache_size=0)
+    path = tmp_path / "trace.json"
+
+    trace.start()
+    service.translate(models[0], SOURCES)
+    assert trace.buffered() > 0
+    assert trace.stop(str(path))
+    assert trace.buffered() == 0
+
+    threads, spans = read(path)
+    batches = [span for span in spans if span["name"] == "batch"]
+    assert batches
+
+    # Batches run on workers, and between them serve every request, by id as
+    # the service numbered them.
+    requests = set()
+    for batch in batches:
+        assert threads[batch["tid"]].startswith("worker ")
+        assert batch["args"]["sentences"] > 0
+        requests.update(int(request) for request in batch["args"]["requests"].split())
+    assert requests == set(range(len(SOURCES)))
+
+    # The encoder, decoder steps and multiplies of a batch run on the thread
+    # of that batch, within it.
+    def batch_of(span):
+        return [
+            batch
+            for batch in batches
+            if batch["tid"] == span["tid"] and within(span, batch)
+        ]
+
+    for name in ["encode", "decode_step"]:
+        found = [span for span in spans if span["name"] == name]
+        assert found, name
+        assert all(len(batch_of(span)) == 1 for span in found), name
+
+    # Multiplies are named after the tensor they produce.
+    qmm = [span for span in spans if span["cat"] == "qmm"]
+    assert all(len(batch_of(span)) == 1 for span in qmm)
+    assert {"q", "k", "v", "o", "ffn1", "ffn2", "logits"} <= {
+        span["name"] for span in qmm
+    }
+    assert all(span["args"]["rows"] > 0 for span in qmm)
+    assert all(span["args"]["depth"] > 0 for span in qmm)
+
+
+def test_trace_disabled(models, tmp_path):
+    service = Service(workers=2, cache_size=0)
+    assert trace.buffered() == 0
+    service.translate(models[0], SOURCES)
+    assert trace.buffered() == 0
+
+    # Nothing recorded meanwhile shows in a trace started after.
+    path = tmp_path / "trace.json"
+    trace.start()
+    assert trace.stop(str(path))
+    _, spans = read(path)
+    assert spans == []
@@ -0,0 +1,57 @@
+# type: ignore
+import random
+
+import pytest
+
+LINES = [
+    "How embarrassing. A fridge full of condiments and no food.",
+    "The quick brown fox, aged 12, jumped over 3 lazy dogs. Didn't it?",
+    "1 2 3 4 5 6 7 8 9",
+    "Hello",
+    # Not memoizable, so encoded whole either way.
+    "  leading and  double spaces ",
+    "no sé 😀 😃",
+]
+
+
+@pytest.mark.parametrize("line", LINES)
+def test_memoized_encoding(models, line):
+    for model in models:
+        vocabulary = model.vocabulary
+        expected = vocabulary.encode_pieces(line)
+
+        # Twice, so that the second goes through a warm memo.
+        assert vocabulary.encode(line) == expected
+        assert vocabulary.encode(line) == expected
+
+
+DECODED = [
+    "How embarrassing. A fridge full of condiments and no food.",
+    "  leading and  double spaces ",
+    # Unknown to the vocabulary, or falling back to bytes where it does.
+    "no sé 😀 😃 ꙮ",
+    "日本語のテキスト、空白なし。",
+    "a 😀b 😀😃 c",
+]
+
+
+@pytest.mark.parametrize("line", DECODED)
+def test_flat_decoding(models, line):
+    for model in models:
+        vocabulary = model.vocabulary
+        assert vocabulary.decodes_flat()
+        words = [word for word, _, _ in vocabulary.encode_pieces(line)]
+        assert vocabulary.decode(words) == vocabulary.decode_pieces(words)
+
+
+def test_flat_decoding_random(models):
+    # Any sequence of ids, which puts pieces where translation may put them
+    # but encoding does not: control pieces anywhere, and pieces starting a
+    # word or not at the start of text.
+    generator = random.Random(42)
+    for model in models:
+        vocabulary = model.vocabulary
+        for _ in range(1000):
+            length = generator.randrange(0, 20)
+            words = [generator.randrange(len(vocabulary)) for _ in range(length)]
+            assert vocabulary.decode(words) == vocabulary.decode_pieces(words)
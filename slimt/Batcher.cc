@@ -2,27 +2,58 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "slimt/Macros.hh"
+#include "slimt/Metrics.hh"
 #include "slimt/Model.hh"
 #include "slimt/Request.hh"
 #include "slimt/Types.hh"
+#include "slimt/Utils.hh"
 
 namespace slimt {
 
 // ------------------------------------------------------------------
 
-SegmentRef::SegmentRef(size_t index, Ptr<Request> request)
-    : index_(index), request_(std::move(request)) {}
+SegmentRef::SegmentRef(size_t index, Ptr<Request> request,
+                       Ptr<Duplicates> duplicates)
+    : index_(index),
+      request_(std::move(request)),
+      duplicates_(std::move(duplicates)),
+      queued_(std::chrono::steady_clock::now()) {}
+
+double SegmentRef::waited() const {
+  std::chrono::duration<double> waited =
+      std::chrono::steady_clock::now() - queued_;
+  return waited.count();
+}
 
 size_t SegmentRef::size() const { return (request_->word_count(index_)); }
 
 void SegmentRef::complete(History history) {
+  // Followers get copies, as a Request may move alignments out of the History
+  // it completes with.
+  if (duplicates_) {
+    std::vector<std::pair<Ptr<Request>, size_t>> followers;
+    {
+      std::lock_guard<std::mutex> guard(duplicates_->mutex);
+      duplicates_->done = true;
+      followers.swap(duplicates_->followers);
+    }
+    for (auto& [request, index] : followers) {
+      request->process(index, std::make_shared<Hypothesis>(*history),
+                       /*follower=*/true);
+    }
+  }
+
   // Relays complete into request's complete, using index
   // information.
   request_->process(index_, std::move(history));
@@ -31,7 +62,12 @@ void SegmentRef::complete(History history) {
 const Segment& SegmentRef::get() const { return request_->segment(index_); }
 
 bool operator<(const Request& a, const Request& b) {
-  // Among Requests, only sequence id is used for obtaining priority.
+  if (a.deadline_ != b.deadline_) {
+    return a.deadline_ < b.deadline_;
+  }
+  if (a.priority_ != b.priority_) {
+    return a.priority_ > b.priority_;
+  }
   return a.id_ < b.id_;
 }
 
@@ -40,7 +76,7 @@ bool operator<(const SegmentRef& a, const SegmentRef& b) {
   if (a.request_ == b.request_) {
     return a.index_ < b.index_;
   }
-  return a.request_ < b.request_;
+  return *a.request_ < *b.request_;
 }
 
 // ----------------------------------------------------------------------
@@ -92,64 +128,166 @@ Batcher::Batcher(size_t max_words, size_t wrap_length,
                  "longer than what can fit in a batch.");
 }
 
-Batch Batcher::generate() {
-  // For now simply iterates on buckets and converts batches greedily.  This
-  // has to be enhanced with optimizing over priority. The baseline
-  // implementation should at least be as fast as marian's maxi-batch with full
-  // corpus size as maxi-batch size.
+Batch Batcher::generate() { return generate(max_words_); }
+
+Batch Batcher::generate(size_t budget) {
+  budget = std::min(budget, max_words_);
+
+  // The most urgent segment anchors the batch, which fills from its bucket,
+  // then shorter buckets, then longer, for as long as the padded batch stays
+  // within budget. Urgency rises with waiting, so long segments too come
+  // to anchor a batch rather than starve behind a stream of short ones.
   Batch batch;
-  size_t padded_batch_size = 0;
+  size_t anchor = this->anchor();
+  if (anchor == bucket_.size()) {
+    return batch;
+  }
 
-  for (size_t length = 0; length <= running_bucket_max_size_; length++) {
-    auto p = bucket_[length].begin();
-    while (p != bucket_[length].end()) {
-      padded_batch_size = (batch.size() + 1) * length;
-      if (padded_batch_size <= max_words_) {
-        auto q = p++;
-        batch.add(*q);
-        bucket_[length].erase(q);
-      } else {
-        // Check if elements exist
-        assert(!batch.empty());
-        return batch;
+  // Whether all of the bucket fit. If not, neither does any bucket further
+  // from the anchor.
+  auto fill = [this, &batch, budget](size_t length) {
+    auto& bucket = bucket_[length];
+    auto p = bucket.begin();
+    while (p != bucket.end()) {
+      size_t max_length = std::max<size_t>(batch.max_length(), length);
+      size_t padded_batch_size = (batch.size() + 1) * max_length;
+      if (!batch.empty() && padded_batch_size > budget) {
+        return false;
+      }
+      batch.add(*p);
+      Metrics::instance()[Stage::kQueue].record(p->waited());
+      if (p->duplicates()) {
+        p->duplicates()->pending = false;
       }
+      p = bucket.erase(p);
+    }
+    return true;
+  };
+
+  if (!fill(anchor)) {
+    return batch;
+  }
+
+  for (size_t length = anchor; length-- > 0;) {
+    if (!fill(length)) {
+      break;
+    }
+  }
+
+  for (size_t length = anchor + 1; length <= running_bucket_max_size_;
+       length++) {
+    if (!fill(length)) {
+      break;
     }
   }
 
   return batch;
 }
 
+size_t Batcher::anchor() const {
+  size_t anchor = bucket_.size();
+  for (size_t length = 0; length <= running_bucket_max_size_; length++) {
+    const auto& bucket = bucket_[length];
+    if (!bucket.empty() && (anchor == bucket_.size() ||
+                            *bucket.begin() < *bucket_[anchor].begin())) {
+      anchor = length;
+    }
+  }
+  return anchor;
+}
+
+const SegmentRef* Batcher::front() const {
+  size_t length = anchor();
+  return length < bucket_.size() ? &(*bucket_[length].begin()) : nullptr;
+}
+
 size_t Batcher::enqueue(const Ptr<Request>& request) {
   size_t to_be_translated = 0;
   for (size_t i = 0; i < request->size(); i++) {
-    if (!request->cached(i)) {
-      SegmentRef sentence(i, request);
-      size_t bucket_id = sentence.size();
-
-      // Due to a workaround for pivoting, unless we can discipline the
-      // vocabulary to get stronger static requirements, it is difficult to
-      // rework the rest of the components. Instead, we allow dynamic growth
-      // here. We let std::vector take care of the dynamic growth.
-      // https://en.cppreference.com/w/cpp/container/vector/resize#Complexity
-      if (bucket_id >= bucket_.size()) {
-        bucket_.resize(bucket_id + 1);
-      }
-
-      bucket_[bucket_id].insert(sentence);
-      running_bucket_max_size_ =
-          std::max<size_t>(bucket_id, running_bucket_max_size_);
-
+    if (!request->cached(i) && admit(request, i)) {
       to_be_translated += 1;
     }
   }
 
+  sweep();
   return to_be_translated;
 }
 
+bool Batcher::admit(const Ptr<Request>& request, size_t index) {
+  const Segment& segment = request->segment(index);
+  auto query = inflight_.find(segment);
+  Ptr<Duplicates> duplicates =
+      query != inflight_.end() ? query->second.lock() : nullptr;
+  if (duplicates) {
+    std::lock_guard<std::mutex> guard(duplicates->mutex);
+    if (!duplicates->done) {
+      // A lead still pending is held by its bucket, so it is alive.
+      Ptr<Request> lead = duplicates->request.lock();
+      if (duplicates->pending && lead && *request < *lead) {
+        // More urgent than the lead, so queues in its place. Identical
+        // segments are of equal length, and share a bucket.
+        auto& bucket = bucket_[segment.size()];
+        bucket.erase(SegmentRef(duplicates->index, lead));
+        bucket.insert(SegmentRef(index, request, duplicates));
+        duplicates->followers.emplace_back(std::move(lead), duplicates->index);
+        duplicates->request = request;
+        duplicates->index = index;
+      } else {
+        duplicates->followers.emplace_back(request, index);
+      }
+      return false;
+    }
+  }
+
+  duplicates = std::make_shared<Duplicates>();
+  duplicates->request = request;
+  duplicates->index = index;
+  inflight_[segment] = duplicates;
+
+  SegmentRef sentence(index, request, std::move(duplicates));
+  size_t bucket_id = sentence.size();
+
+  // Due to a workaround for pivoting, unless we can discipline the
+  // vocabulary to get stronger static requirements, it is difficult to
+  // rework the rest of the components. Instead, we allow dynamic growth
+  // here. We let std::vector take care of the dynamic growth.
+  // https://en.cppreference.com/w/cpp/container/vector/resize#Complexity
+  if (bucket_id >= bucket_.size()) {
+    bucket_.resize(bucket_id + 1);
+  }
+
+  bucket_[bucket_id].insert(sentence);
+  running_bucket_max_size_ =
+      std::max<size_t>(bucket_id, running_bucket_max_size_);
+  return true;
+}
+
+void Batcher::sweep() {
+  constexpr size_t kSweep = 1024;
+  if (inflight_.size() < sweep_at_) {
+    return;
+  }
+
+  std::erase_if(inflight_, [](const auto& entry) {
+    const auto& [segment, duplicates] = entry;
+    return duplicates.expired();
+  });
+  sweep_at_ = std::max<size_t>(2 * inflight_.size(), kSweep);
+}
+
+size_t Batcher::SegmentHash::operator()(const Segment& segment) const {
+  size_t seed = segment.size();
+  for (Word word : segment) {
+    hash_combine<size_t>(seed, word);
+  }
+  return seed;
+}
+
 void Batcher::clear() {
   for (auto& item : bucket_) {
     item.clear();
   }
+  inflight_.clear();
 }
 
 AggregateBatcher::AggregateBatcher(
@@ -183,22 +321,93 @@ size_t AggregateBatcher::enqueue(const Ptr<Model>& model,
 }
 
 std::tuple<Batch, Ptr<Model>> AggregateBatcher::generate() {
-  while (!queue_.empty()) {
-    auto model_iterator = queue_.begin();
-    Ptr<Model> model = *model_iterator;
-    auto query = batcher_.find(model->id());
-    Batcher& batcher = query->second;
-    Batch batch = batcher.generate();
-    if (!batch.empty()) {
-      return {std::move(batch), std::move(model)};
+  return generate(max_words_);
+}
+
+std::tuple<Batch, Ptr<Model>> AggregateBatcher::generate(size_t budget) {
+  // Serve the Model holding the most urgent segment across all Models, so
+  // that urgency is respected across Models as well. Models with nothing
+  // pending leave the queue.
+  Ptr<Model> model = nullptr;
+  const SegmentRef* urgent = nullptr;
+  auto model_iterator = queue_.begin();
+  while (model_iterator != queue_.end()) {
+    const Batcher& batcher = batcher_.find((*model_iterator)->id())->second;
+    const SegmentRef* front = batcher.front();
+    if (front == nullptr) {
+      model_iterator = queue_.erase(model_iterator);
+      continue;
+    }
+    if (urgent == nullptr || *front < *urgent) {
+      urgent = front;
+      model = *model_iterator;
     }
-    queue_.erase(model_iterator);
+    ++model_iterator;
   }
-  // Empty.
-  Batch batch;
-  return {std::move(batch), nullptr};
+
+  if (model == nullptr) {
+    // Empty.
+    Batch batch;
+    return {std::move(batch), nullptr};
+  }
+
+  Batcher& batcher = batcher_.find(model->id())->second;
+  Batch batch = batcher.generate(budget);
+  return {std::move(batch), std::move(model)};
+}
+
+std::tuple<Batch, Ptr<Model>> AggregateBatcher::generate(
+    const Ptr<Model>& model, size_t budget) {
+  auto query = batcher_.find(model->id());
+  if (query == batcher_.end()) {
+    Batch batch;
+    return {std::move(batch), model};
+  }
+
+  Batch batch = query->second.generate(budget);
+  return {std::move(batch), model};
 }
 
 void AggregateBatcher::clear() { queue_.clear(); }
 
+BatchController::BatchController(size_t max_words, size_t target)
+    : max_words_(max_words), target_(target), budget_(max_words) {}
+
+void BatchController::record(size_t tokens, double seconds) {
+  if (tokens == 0) {
+    return;
+  }
+
+  constexpr double kSmoothing = 0.1;
+  double token_latency = seconds / static_cast<double>(tokens);
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (batches_ == 0) {
+    latency_ = seconds;
+    token_latency_ = token_latency;
+  } else {
+    latency_ += kSmoothing * (seconds - latency_);
+    token_latency_ += kSmoothing * (token_latency - token_latency_);
+  }
+  ++batches_;
+
+  if (target_ != 0 && token_latency_ > 0) {
+    constexpr double kMilliseconds = 1000.0;
+    double target = static_cast<double>(target_) / kMilliseconds;
+    auto budget = static_cast<size_t>(target / token_latency_);
+    budget_.store(std::clamp<size_t>(budget, 1, max_words_),
+                  std::memory_order_relaxed);
+  }
+}
+
+BatchController::State BatchController::state() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return State{
+      .budget = budget(),               //
+      .latency = latency_,              //
+      .token_latency = token_latency_,  //
+      .batches = batches_               //
+  };
+}
+
 }  // namespace slimt
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <memory>
@@ -19,13 +21,28 @@ namespace slimt {
 class Model;
 class Request;
 
+/// Segments identical to one pending or being translated, which wait for its
+/// History instead of being translated again. Only the lead is batched, and
+/// completing it completes the followers too.
+struct Duplicates {
+  /// The lead, which stays pending in a bucket until a batch takes it.
+  std::weak_ptr<Request> request;
+  size_t index;
+  bool pending = true;
+
+  /// Guards followers and done, as the lead completes on a worker.
+  std::mutex mutex;
+  std::vector<std::pair<Ptr<Request>, size_t>> followers;
+  bool done = false;
+};
+
 /// A SegmentRef provides a view to a segment within a Request. Existence
 /// of this class allows the segments and associated information to be kept
 /// within Request, while batching mechanism (BatchingPool) compiles Batch
 /// from SegmentRef-s coming from different Requests.
 class SegmentRef {
  public:
-  SegmentRef(size_t, Ptr<Request>);
+  SegmentRef(size_t, Ptr<Request>, Ptr<Duplicates> duplicates = nullptr);
 
   /// Number of tokens in the segment this SegmentRef represents. Used to
   /// order by length in batching.
@@ -35,14 +52,22 @@ class SegmentRef {
   const Segment &get() const;
 
   /// Forwards history to Request to set history corresponding to this
-  /// SegmentRef.
+  /// SegmentRef, and to any Duplicates waiting on it.
   void complete(History history);
 
+  const Ptr<Duplicates> &duplicates() const { return duplicates_; }
+  const Ptr<Request> &request() const { return request_; }
+
+  /// Seconds since the SegmentRef was made, on enqueueing.
+  double waited() const;
+
   friend bool operator<(const SegmentRef &a, const SegmentRef &b);
 
  private:
   size_t index_;
   Ptr<Request> request_;
+  Ptr<Duplicates> duplicates_;
+  std::chrono::steady_clock::time_point queued_;
 };
 
 using SegmentRefs = std::vector<SegmentRef>;
@@ -92,19 +117,52 @@ class Batcher {
   // SegmentRef incorporates (tentative) notions of priority with each
   // sentence. This method inserts the sentence into the internal data-structure
   // which maintains priority among sentences from multiple concurrent requests.
+  //
+  // A sentence identical to one pending or in flight follows it instead, and
+  // is not counted among those added. If more urgent than the one pending, it
+  // takes its place in the queue.
   size_t enqueue(const Ptr<Request> &request);
 
   // Loads sentences with sentences compiled from (tentatively) multiple
   // requests optimizing for both padding and priority.
   Batch generate();
 
+  // As above, with at most budget padded tokens (capped at max_words). A
+  // batch always takes at least one sentence, however long.
+  Batch generate(size_t budget);
+
+  // The most urgent pending sentence, which the next generate() includes, or
+  // nullptr if none is pending.
+  const SegmentRef *front() const;
+
   // Removes any pending requests from the pool.
   void clear();
 
  private:
+  // Length of the bucket holding the most urgent sentence, or bucket_.size()
+  // if none is pending.
+  size_t anchor() const;
+
+  // Queues sentence at index of request, unless it follows a duplicate.
+  // @returns whether it was queued.
+  bool admit(const Ptr<Request> &request, size_t index);
+
+  // Erases entries of segments no longer pending or in flight, once entries
+  // have doubled since the last sweep.
+  void sweep();
+
+  struct SegmentHash {
+    size_t operator()(const Segment &segment) const;
+  };
+
   size_t max_words_;
   std::vector<std::set<SegmentRef>> bucket_;
   size_t running_bucket_max_size_{0};
+
+  // Sentences pending or in flight, by their words. Entries expire as the
+  // last SegmentRef of their lead goes.
+  std::unordered_map<Segment, std::weak_ptr<Duplicates>, SegmentHash> inflight_;
+  size_t sweep_at_ = 0;
 };
 
 /// Aggregates request queueing and generation of batches from multiple
@@ -112,11 +170,10 @@ class Batcher {
 /// intermediary to enable multiple translation model capability in
 /// BlockingService and AsyncService.
 ///
-/// A simple queue containing shared owning references to Models are
-/// held here from which batches are generated on demand. Since a queue is
-/// involved, the ordering is first-come first serve on requests except there
-/// are leaks effectively doing priority inversion if an earlier request with
-/// the same Model is pending to be consumed for translation.
+/// A set containing shared owning references to Models are held here from
+/// which batches are generated on demand. Each batch goes to the Model with
+/// the most urgent pending sentence (see Request ordering), so priorities and
+/// deadlines hold across Models too.
 //
 /// Actual storage for the request and batch generation are within the
 /// respective Models, which owns its own Batcher.
@@ -156,6 +213,13 @@ class AggregateBatcher {
   /// @returns Number of sentences in the generated batch.
   std::tuple<Batch, Ptr<Model>> generate();
 
+  /// As above, with at most budget padded tokens in the batch.
+  std::tuple<Batch, Ptr<Model>> generate(size_t budget);
+
+  /// As above, but only from sentences pending for model.
+  std::tuple<Batch, Ptr<Model>> generate(const Ptr<Model> &model,
+                                         size_t budget);
+
   /// Clear the aggregate queue. Does not clear the underlying model/request
   /// pairs but the next call to `generate()` will return 0. (Unless
   /// `enqueue()` was called in the mean time.)
@@ -179,6 +243,48 @@ class AggregateBatcher {
   float tgt_length_limit_factor_;  //
 };
 
+/// Adapts the budget of padded tokens in a batch towards a target latency,
+/// from the time batches are measured to take to translate.
+///
+/// Time per padded token is smoothed over recent batches, and the budget set
+/// to what it predicts will take target. Smaller batches come back sooner
+/// under interactive load. Larger ones keep throughput up as long as they
+/// stay within target. Without a target, the budget stays at max_words.
+///
+/// Safe to use from multiple workers: budget() is a relaxed read, and
+/// record() serializes updates.
+class BatchController {
+ public:
+  struct State {
+    size_t budget;         ///< Padded tokens a batch may currently hold.
+    double latency;        ///< Smoothed seconds to translate a batch.
+    double token_latency;  ///< Smoothed seconds per padded token.
+    size_t batches;        ///< Batches recorded so far.
+  };
+
+  /// @param [in] max_words: Largest budget, and the budget if target is 0.
+  /// @param [in] target: Milliseconds a batch should take, or 0 for none.
+  BatchController(size_t max_words, size_t target);
+
+  size_t budget() const { return budget_.load(std::memory_order_relaxed); }
+
+  /// Records that a batch of tokens padded tokens took seconds to translate.
+  void record(size_t tokens, double seconds);
+
+  State state() const;
+
+ private:
+  size_t max_words_;
+  size_t target_;
+
+  double latency_ = 0;
+  double token_latency_ = 0;
+  size_t batches_ = 0;
+  mutable std::mutex mutex_;
+
+  std::atomic<size_t> budget_;
+};
+
 /// The following mechanism operates in a multithreaded async-workflow guarding
 /// access to the pushes to the structure keeping sentences bucketed by length
 /// and sorted by priority.
@@ -219,6 +325,16 @@ class Threadsafe {
     work_.notify_all();
   }
 
+  // As generate(), but returns an empty batch at once rather than wait if
+  // there is nothing to generate from.
+  template <class... Args>
+  auto try_generate(Args &&...args) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto pack = backend_.generate(std::forward<Args>(args)...);
+    enqueued_ -= std::get<0>(pack).size();
+    return pack;
+  }
+
   void clear() {
     std::unique_lock<std::mutex> lock(mutex_);
     backend_.clear();
@@ -232,10 +348,10 @@ class Threadsafe {
   }
 
   template <class... Args>
-  auto generate() {
+  auto generate(Args &&...args) {
     std::unique_lock<std::mutex> lock(mutex_);
     work_.wait(lock, [this]() { return enqueued_ || shutdown_; });
-    auto pack = backend_.generate();
+    auto pack = backend_.generate(std::forward<Args>(args)...);
     auto batch = std::get<0>(pack);
     assert(!batch.empty() || shutdown_);
     enqueued_ -= batch.size();
@@ -1,58 +1,151 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 namespace slimt {
 
+/// AtomicCache is an N-way set-associative cache, safe to use concurrently.
+///
+/// A key hashes to a set of ways slots, any of which may hold it, so keys
+/// whose hashes land on the same set need not evict each other. Entries keep
+/// the full key, which lookups compare, so keys with colliding hashes are told
+/// apart rather than answered with each other's values.
+///
+/// Each set has a mutex of its own, held for the few comparisons and copies
+/// a lookup or store makes, so that threads contend only on keys hashing to
+/// the same set. Lookups copy their value out, so hold nothing once they
+/// return.
+///
+/// Replacement within a set is CLOCK: a hit marks its slot referenced, and a
+/// store advances the set's hand past referenced slots, clearing their marks,
+/// to the first unreferenced one. Entries hit since the hand last passed
+/// survive, approximating LRU.
+///
+/// Hash and Equals may be transparent, for find() to take other types which
+/// compare against Key without constructing one.
 template <class Key, class Value, class Hash = std::hash<Key>,
           class Equals = std::equal_to<Key>>
 class AtomicCache {
  public:
-  explicit AtomicCache(size_t size, size_t buckets)
-      : records_(size), locks_(buckets) {}
+  struct Stats {
+    size_t hits;        ///< Lookups finding their key.
+    size_t misses;      ///< Lookups not finding their key.
+    size_t evictions;  ///< Entries replaced by another key.
+    size_t conflicts;  ///< Evictions from sets every entry of which was hit
+                       ///< since the hand last passed: hot keys contending.
+  };
 
-  std::pair<bool, Value> find(const Key &key) const {
-    Value value;
-    bool found = atomic_load(key, value);
-    return std::make_pair(found, value);
+  /// @param [in] size: Entries to hold, rounded up to a multiple of ways.
+  /// @param [in] ways: Slots in a set.
+  explicit AtomicCache(size_t size, size_t ways)
+      : ways_(std::max<size_t>(ways, 1)),
+        sets_(std::max<size_t>((size + ways_ - 1) / ways_, 1)),
+        slots_(sets_ * ways_),
+        hands_(sets_, 0),
+        mutexes_(sets_) {}
+
+  template <class Lookup = Key>
+  std::pair<bool, Value> find(const Lookup &key) const {
+    size_t hash = hash_(key);
+    size_t index = hash % sets_;
+    Slot *set = &slots_[index * ways_];
+    std::lock_guard<std::mutex> guard(mutexes_[index]);
+    for (size_t way = 0; way < ways_; way++) {
+      Slot &slot = set[way];
+      const Entry *entry = slot.entry.get();
+      if (entry && entry->hash == hash && equals_(entry->key, key)) {
+        slot.referenced = true;
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return std::make_pair(true, entry->value);
+      }
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::make_pair(false, Value());
   }
 
-  void store(const Key &key, Value value) { atomic_store(key, value); }
+  void store(const Key &key, Value value) {
+    size_t hash = hash_(key);
+    size_t index = hash % sets_;
+    Slot *set = &slots_[index * ways_];
+    auto entry = std::make_unique<const Entry>(hash, key, std::move(value));
+    std::lock_guard<std::mutex> guard(mutexes_[index]);
 
- private:
-  using Record = std::pair<Key, Value>;
-
-  bool atomic_load(const Key &key, Value &value) const {
-    // No probing, direct map onto records_
-    size_t index = hash_(key) % records_.size();
-    size_t lock_id = index % locks_.size();
-
-    std::lock_guard<std::mutex> guard(locks_[lock_id]);
-    const Record &candidate = records_[index];
-    if (equals_(key, candidate.first)) {
-      value = candidate.second;
-      return true;
+    // Another thread may have stored the same key meanwhile. Replacing it
+    // keeps a key in at most one slot.
+    for (size_t way = 0; way < ways_; way++) {
+      Slot &slot = set[way];
+      const Entry *existing = slot.entry.get();
+      if (existing && existing->hash == hash && equals_(existing->key, key)) {
+        slot.entry = std::move(entry);
+        return;
+      }
+    }
+
+    // One sweep clears every mark, so a second always finds a victim. Having
+    // to clear them all, the victim was hit too.
+    size_t &hand = hands_[index];
+    size_t cleared = 0;
+    while (true) {
+      Slot &slot = set[hand++ % ways_];
+      if (!slot.referenced) {
+        if (slot.entry) {
+          evictions_.fetch_add(1, std::memory_order_relaxed);
+          if (cleared >= ways_) {
+            conflicts_.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+        slot.entry = std::move(entry);
+        return;
+      }
+      slot.referenced = false;
+      ++cleared;
     }
+  }
 
-    return false;
+  Stats stats() const {
+    return Stats{
+        .hits = hits_.load(std::memory_order_relaxed),             //
+        .misses = misses_.load(std::memory_order_relaxed),         //
+        .evictions = evictions_.load(std::memory_order_relaxed),  //
+        .conflicts = conflicts_.load(std::memory_order_relaxed)   //
+    };
   }
 
-  void atomic_store(const Key &key, Value value) {
-    // No probing, direct map onto records_
-    size_t index = hash_(key) % records_.size();
-    size_t lock_id = index % locks_.size();
+ private:
+  struct Entry {
+    Entry(size_t hash, Key key, Value value)
+        : hash(hash), key(std::move(key)), value(std::move(value)) {}
 
-    std::lock_guard<std::mutex> guard(locks_[lock_id]);
-    Record &candidate = records_[index];
+    size_t hash;
+    Key key;
+    Value value;
+  };
 
-    candidate.first = key;
-    candidate.second = value;
-  }
+  struct Slot {
+    std::unique_ptr<const Entry> entry;
+    bool referenced = false;
+  };
+
+  size_t ways_;
+  size_t sets_;
+
+  // Slots and hands are guarded by the mutex of their set.
+  mutable std::vector<Slot> slots_;
+  std::vector<size_t> hands_;
+  mutable std::vector<std::mutex> mutexes_;
+
+  mutable std::atomic<size_t> hits_ = 0;
+  mutable std::atomic<size_t> misses_ = 0;
+  std::atomic<size_t> evictions_ = 0;
+  std::atomic<size_t> conflicts_ = 0;
 
-  std::vector<Record> records_;
-  mutable std::vector<std::mutex> locks_;
   Hash hash_;
   Equals equals_;
 };
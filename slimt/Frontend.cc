@@ -1,13 +1,23 @@
 #include "slimt/Frontend.hh"
 
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <future>
+#include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -15,10 +25,15 @@
 #include "slimt/Batcher.hh"
 #include "slimt/HTML.hh"
 #include "slimt/Input.hh"
+#include "slimt/Macros.hh"
+#include "slimt/Metrics.hh"
 #include "slimt/Model.hh"
 #include "slimt/Request.hh"
 #include "slimt/Response.hh"
 #include "slimt/TextProcessor.hh"
+#include "slimt/ThreadPool.hh"
+#include "slimt/Topology.hh"
+#include "slimt/Trace.hh"
 #include "slimt/Types.hh"
 #include "slimt/Utils.hh"
 #include "slimt/Vocabulary.hh"
@@ -39,54 +54,276 @@ Input convert(const Batch &batch, uint32_t pad_id, float limit_factor) {
   return input;
 }
 
-void exhaust(const Config &config, const Ptr<Model> &model, Batcher &batcher) {
-  AverageMeter<float> wps;
-  AverageMeter<float> occupancy;
-  Batch batch = batcher.generate();
-  while (!batch.empty()) {
-    // convert between batches.
+// Records how much of a batch padding left to words, and how fast its words
+// translated, taking seconds.
+void measure(float occupancy, size_t words, double seconds) {
+  Metrics &metrics = Metrics::instance();
+  metrics[Measure::kOccupancy].record(occupancy);
+  if (seconds > 0) {
+    double wps = static_cast<double>(words) / seconds;
+    metrics[Measure::kWordsPerSecond].record(wps);
+  }
+}
+
+// Annotates span with the shape of batch, and the requests it serves.
+void annotate(Span &span, const Batch &batch) {
+  if (!span) {
+    return;
+  }
+
+  span.arg("sentences", batch.size());
+  span.arg("max_length", batch.max_length());
+
+  std::set<size_t> ids;
+  for (const SegmentRef &segment_ref : batch.segment_refs()) {
+    ids.insert(segment_ref.request()->id());
+  }
+
+  std::string requests;
+  for (size_t id : ids) {
+    requests += (requests.empty() ? "" : " ") + std::to_string(id);
+  }
+  span.arg("requests", requests);
+}
+
+// Translates batches on the calling thread, or with a pool, on the pool and
+// the calling thread, which picks up queued batches while waiting. Only one
+// batch per thread is let in flight, so that each batch generated meanwhile
+// still sees the budget controller has adapted to.
+class Dispatch {
+ public:
+  Dispatch(const Config &config, const Ptr<Model> &model,
+           BatchController &controller, ThreadPool *pool)
+      : config_(config), model_(model), controller_(controller), pool_(pool) {}
+
+  ~Dispatch() { wait(); }
+
+  void operator()(Batch &&batch) {
+    if (!pool_) {
+      translate(batch);
+      return;
+    }
+
+    if (inflight_.size() > pool_->size()) {
+      wait_one();
+    }
+    inflight_.push_back(
+        pool_->submit(group_, [this, batch = std::move(batch)]() mutable {
+          translate(batch);
+        }));
+  }
+
+  // Waits for the oldest batch in flight. @returns false if there was none.
+  bool wait_one() {
+    if (inflight_.empty()) {
+      return false;
+    }
+    pool_->wait(group_, inflight_.front());
+    inflight_.pop_front();
+    return true;
+  }
+
+  void wait() {
+    while (wait_one()) {
+    }
+  }
+
+ private:
+  void translate(Batch &batch) {
+    Span span("batch");
+    annotate(span, batch);
     Timer timer;
-    Input input = convert(batch, model->vocabulary().pad_id(),
-                          config.tgt_length_limit_factor);
-    Histories histories = model->forward(input);
+    Input input = convert(batch, model_->vocabulary().pad_id(),
+                          config_.tgt_length_limit_factor);
+    Histories histories = model_->forward(input);
+    double seconds = timer.elapsed();
+    controller_.record(batch.size() * batch.max_length(), seconds);
+    measure(input.occupancy(), input.words().size(), seconds);
     batch.complete(histories);
-    batch = batcher.generate();
+  }
 
-    auto elapsed = static_cast<float>(timer.elapsed());
-    float sample_wps = input.words().size() / elapsed;
-    wps.record(sample_wps);
-    occupancy.record(input.occupancy());
+  const Config &config_;
+  const Ptr<Model> &model_;
+  BatchController &controller_;
+  ThreadPool *pool_;
+  ThreadPool::Group group_;
+  std::deque<std::future<void>> inflight_;
+};
+
+// Translates every batch batcher generates.
+void exhaust(const Config &config, const Ptr<Model> &model, Batcher &batcher,
+             BatchController &controller, ThreadPool *pool) {
+  Dispatch dispatch(config, model, controller, pool);
+  Batch batch = batcher.generate(controller.budget());
+  while (!batch.empty()) {
+    dispatch(std::move(batch));
+    batch = batcher.generate(controller.budget());
+  }
+  dispatch.wait();
+}
+
+// Keeps a Model::Live decoding, topping it up between steps with sentences
+// arriving for the same Model, so that slots freed by sentences completing
+// early are refilled instead of idling until the longest completes.
+// Batches decode on local(model), while sentences keep arriving for model.
+//
+// Sentences joining together are recorded with controller as a batch once
+// the last of them completes: the padded tokens decoding as they joined, and
+// the time until then. The budget then bounds how long a sentence takes with
+// everything it decodes alongside, as it bounds a batch otherwise. They are
+// measured as a batch too, with the occupancy they joined with.
+void continuous(const Config &config, Threadsafe<AggregateBatcher> &batcher,
+                BatchController &controller,
+                const std::function<Ptr<Model>(const Ptr<Model> &)> &local) {
+  struct Cohort {
+    size_t remaining;
+    size_t tokens;
+    float occupancy;
+    size_t words;
+    Timer timer;
+  };
+
+  struct Decoding {
+    SegmentRef segment_ref;
+    std::shared_ptr<Cohort> cohort;
+  };
+
+  while (true) {
+    auto [batch, model] = batcher.generate(controller.budget());
+    if (batch.empty()) {
+      return;
+    }
+
+    Ptr<Model> decoding_model = local(model);
+    Model::Live live(*decoding_model);
+    std::unordered_map<size_t, Decoding> decoding;
+    auto join = [&](const Batch &joining) {
+      Span span("join");
+      annotate(span, joining);
+      Input input = convert(joining, model->vocabulary().pad_id(),
+                            config.tgt_length_limit_factor);
+      size_t tag = live.join(input);
+      auto cohort = std::make_shared<Cohort>(Cohort{
+          .remaining = joining.size(),     //
+          .tokens = live.tokens(),         //
+          .occupancy = input.occupancy(),  //
+          .words = input.words().size(),   //
+          .timer = Timer()                 //
+      });
+      for (const SegmentRef &segment_ref : joining.segment_refs()) {
+        decoding.emplace(tag++, Decoding{segment_ref, cohort});
+      }
+    };
+
+    join(batch);
+    while (!live.empty()) {
+      for (auto &[tag, history] : live.step()) {
+        auto query = decoding.find(tag);
+        Decoding &completed = query->second;
+        completed.segment_ref.complete(std::move(history));
+        Cohort &cohort = *completed.cohort;
+        if (--cohort.remaining == 0) {
+          double seconds = cohort.timer.elapsed();
+          controller.record(cohort.tokens, seconds);
+          measure(cohort.occupancy, cohort.words, seconds);
+        }
+        decoding.erase(query);
+      }
+
+      size_t budget = controller.budget();
+      if (live.tokens() < budget) {
+        auto [arrived, _] = batcher.try_generate(model, budget - live.tokens());
+        if (!arrived.empty()) {
+          join(arrived);
+        }
+      }
+    }
   }
 }
 
+// Source and segments for second to translate the target of pivot, which
+// first translated. With a vocabulary in common, the words first decoded are
+// already segments for second, sparing splitting and tokenizing the target
+// text again. Words cut short of EOS by the length limit go through text.
+std::tuple<AnnotatedText, Segments> handoff(const Model &first,
+                                            const Model &second,
+                                            Response &pivot) {
+  const AnnotatedText &target = pivot.target;
+  bool direct = first.shares_vocabulary(second) &&
+                pivot.words.size() == target.sentence_count();
+
+  Word eos = second.vocabulary().eos_id();
+  for (size_t i = 0; direct && i < pivot.words.size(); i++) {
+    const Words &words = pivot.words[i];
+    direct = !words.empty() && words.back() == eos &&
+             words.size() == target.word_count(i);
+  }
+
+  if (!direct) {
+    return second.processor().process(pivot.target);
+  }
+  return {pivot.target, std::move(pivot.words)};
+}
+
 template <class Continuation>
 Ptr<Request> make_request(size_t id, const Ptr<Model> &model,
                           std::optional<TranslationCache> &cache,
+                          TranslationStore *store,
                           AnnotatedText &&annotated_text, Segments &&segments,
-                          Continuation &&continuation) {
-  auto request = std::make_shared<Request>(     //
-      id, model->id(),                          //
-      std::move(annotated_text),                //
-      std::move(segments),                      //
-      model->vocabulary(),                      //
-      cache,                                    //
-      std::forward<Continuation>(continuation)  //
+                          Continuation &&continuation,
+                          const Options &options) {
+  // Only cached translations are keyed by the model's files, so digesting
+  // them waits for a cache or store.
+  uint64_t fingerprint = cache || store ? model->fingerprint() : 0;
+  auto request = std::make_shared<Request>(      //
+      id, fingerprint,                           //
+      std::move(annotated_text),                 //
+      std::move(segments),                       //
+      model->vocabulary(),                       //
+      cache,                                     //
+      store,                                     //
+      std::forward<Continuation>(continuation),  //
+      options                                    //
   );
   return request;
 }
 
 std::optional<TranslationCache> make_cache(size_t cache_size) {
-  constexpr size_t kCacheBucketSize = 16;
+  constexpr size_t kCacheWays = 8;
   if (cache_size > 0) {
-    return std::make_optional<TranslationCache>(cache_size, kCacheBucketSize);
+    return std::make_optional<TranslationCache>(cache_size, kCacheWays);
   }
   return std::nullopt;
 }
 
+std::unique_ptr<TranslationStore> make_store(const std::string &cache_file) {
+  if (!cache_file.empty()) {
+    return std::make_unique<TranslationStore>(cache_file);
+  }
+  return nullptr;
+}
+
+TranslationCache::Stats cache_stats(
+    const std::optional<TranslationCache> &cache) {
+  if (cache) {
+    return cache->stats();
+  }
+  return TranslationCache::Stats{};
+}
+
 }  // namespace
 
 Blocking::Blocking(const Config &config)
-    : config_(config), cache_(make_cache(config.cache_size)) {}  // NOLINT
+    : config_(config),
+      cache_(make_cache(config.cache_size)),
+      store_(make_store(config.cache_file)) {
+  // The calling thread translates too, as the last of workers.
+  if (config.workers > 1) {
+    pool_ = std::make_unique<ThreadPool>(config.workers - 1);
+  }
+}
+
+Blocking::~Blocking() = default;
 
 std::vector<Response> Blocking::translate(const Ptr<Model> &model,
                                           std::vector<std::string> sources,
@@ -126,13 +363,14 @@ std::vector<Response> Blocking::translate(const Ptr<Model> &model,
     const auto &processor = model->processor();
     auto [annotated, segments] =
         processor.process(std::move(source), config_.wrap_length);
-    auto request = make_request(id(), model, cache_, std::move(annotated),
-                                std::move(segments), continuation);
+    auto request = make_request(id(), model, cache_, store_.get(),
+                                std::move(annotated), std::move(segments),
+                                continuation, options);
 
     batcher.enqueue(request);
   }
 
-  exhaust(config_, model, batcher);
+  exhaust(config_, model, batcher, controller(*model), pool_.get());
 
   std::vector<Response> responses;
   responses.reserve(futures.size());
@@ -144,6 +382,83 @@ std::vector<Response> Blocking::translate(const Ptr<Model> &model,
   return responses;
 }
 
+size_t Blocking::translate(const Ptr<Model> &model, const Reader &read,
+                           const Writer &write, const Options &options,
+                           size_t window) {
+  Batcher batcher(config_.max_words, config_.wrap_length,
+                  config_.tgt_length_limit_factor);
+  BatchController &controller = this->controller(*model);
+  Dispatch dispatch(config_, model, controller, pool_.get());
+
+  // Futures of sources in flight, in the order read. Requests complete out
+  // of order, but are written in order, as soon as those before are done.
+  std::deque<Future> pending;
+  bool exhausted = false;
+  size_t written = 0;
+
+  auto refill = [&]() {
+    std::string source;
+    while (!exhausted && pending.size() < window) {
+      if (!read(source)) {
+        exhausted = true;
+        break;
+      }
+
+      Ptr<HTML> html = nullptr;
+      if (options.html) {
+        html = std::make_shared<HTML>(source);
+      }
+
+      auto promise = std::make_shared<Promise>();
+      pending.push_back(promise->get_future());
+      auto continuation = [promise, html](Response &&response) {
+        if (html) {
+          html->restore(response);
+        }
+        promise->set_value(std::move(response));
+        return nullptr;
+      };
+
+      const auto &processor = model->processor();
+      auto [annotated, segments] =
+          processor.process(std::move(source), config_.wrap_length);
+      auto request = make_request(id(), model, cache_, store_.get(),
+                                  std::move(annotated), std::move(segments),
+                                  continuation, options);
+      batcher.enqueue(request);
+    }
+  };
+
+  auto flush = [&]() {
+    constexpr auto kNow = std::chrono::seconds(0);
+    while (!pending.empty() &&
+           pending.front().wait_for(kNow) == std::future_status::ready) {
+      write(pending.front().get());
+      pending.pop_front();
+      ++written;
+    }
+  };
+
+  // Earlier sources have earlier deadlines, so batches favour the front of
+  // the window, which is what holds up writing.
+  refill();
+  while (!pending.empty()) {
+    Batch batch = batcher.generate(controller.budget());
+    if (!batch.empty()) {
+      dispatch(std::move(batch));
+    } else if (!dispatch.wait_one()) {
+      // Nothing queued or in flight, so everything pending is complete.
+      SLIMT_ABORT_IF(pending.front().wait_for(std::chrono::seconds(0)) !=
+                         std::future_status::ready,
+                     "Pending source with nothing left to translate.");
+    }
+    flush();
+    refill();
+  }
+
+  return written;
+}
+
 std::vector<Response> Blocking::pivot(const Ptr<Model> &first,
                                       const Ptr<Model> &second,
                                       std::vector<std::string> sources,
@@ -157,23 +472,27 @@ std::vector<Response> Blocking::pivot(const Ptr<Model> &first,
     }
   }
 
-  // Translate source to pivots.
-  std::vector<Response> source_to_pivots;
   Options raw{
       .alignment = options.alignment,  //
-      .html = false                    //
+      .html = false,                   //
+      .priority = options.priority,    //
+      .deadline = options.deadline     //
   };
 
-  source_to_pivots = translate(first, std::move(sources), raw);
-
-  // Translate pivots to targets, after we have outputs at pivot from first
-  // round.
-  std::vector<Response> responses(source_to_pivots.size());
-
+  // A source moves on to the second Model as soon as its pivot is complete,
+  // so that both Models translate at once. Batches of both go to the same
+  // workers, each Model adapting batch size to its own cost.
+  std::vector<Response> source_to_pivots(sources.size());
+  std::vector<Response> responses(sources.size());
   Batcher batcher(config_.max_words, config_.wrap_length,
                   config_.tgt_length_limit_factor);
 
-  for (size_t i = 0; i < source_to_pivots.size(); i++) {
+  // Pivots complete on whichever thread translates their last sentence.
+  std::mutex mutex;
+  Batcher pivots(config_.max_words, config_.wrap_length,
+                 config_.tgt_length_limit_factor);
+
+  for (size_t i = 0; i < sources.size(); i++) {
     Response &source_to_pivot = source_to_pivots[i];
     Response &response = responses[i];
 
@@ -185,15 +504,58 @@ std::vector<Response> Blocking::pivot(const Ptr<Model> &first,
       return nullptr;
     };
 
-    const TextProcessor &processor = second->processor();
-    auto [annotated, segments] = processor.process(source_to_pivot.target);
-    auto request = make_request(id(), second, cache_, std::move(annotated),
-                                std::move(segments), continuation);
+    // Runs on whichever thread completes the last sentence of the source, or
+    // here if all cached.
+    auto relay = [this, &first, &second, &mutex, &pivots, &raw,
+                  &source_to_pivot, continuation](Response &&pivot) {
+      source_to_pivot = std::move(pivot);
+      auto [annotated, segments] = handoff(*first, *second, source_to_pivot);
+      auto request = make_request(id(), second, cache_, store_.get(),
+                                  std::move(annotated), std::move(segments),
+                                  continuation, raw);
+      std::lock_guard<std::mutex> guard(mutex);
+      pivots.enqueue(request);
+      return nullptr;
+    };
+
+    const auto &processor = first->processor();
+    auto [annotated, segments] =
+        processor.process(std::move(sources[i]), config_.wrap_length);
+    auto request = make_request(id(), first, cache_, store_.get(),
+                                std::move(annotated), std::move(segments),
+                                relay, raw);
 
     batcher.enqueue(request);
   }
 
-  exhaust(config_, second, batcher);
+  BatchController &first_controller = controller(*first);
+  BatchController &second_controller = controller(*second);
+  Dispatch first_dispatch(config_, first, first_controller, pool_.get());
+  Dispatch second_dispatch(config_, second, second_controller, pool_.get());
+
+  // Second leg first, as each of its batches completes sources. Once neither
+  // has anything queued, waiting on a batch in flight may queue more.
+  while (true) {
+    Batch batch;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      batch = pivots.generate(second_controller.budget());
+    }
+    if (!batch.empty()) {
+      second_dispatch(std::move(batch));
+      continue;
+    }
+
+    batch = batcher.generate(first_controller.budget());
+    if (!batch.empty()) {
+      first_dispatch(std::move(batch));
+      continue;
+    }
+
+    if (!first_dispatch.wait_one() && !second_dispatch.wait_one()) {
+      break;
+    }
+  }
 
   if (options.html) {
     for (size_t i = 0; i < responses.size(); i++) {
@@ -204,21 +566,159 @@ std::vector<Response> Blocking::pivot(const Ptr<Model> &first,
   return responses;
 }
 
+BatchController &Blocking::controller(const Model &model) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto [entry, _] = controllers_.try_emplace(model.id(), config_.max_words,
+                                             config_.target_latency);
+  return entry->second;
+}
+
+BatchController::State Blocking::batching(const Ptr<Model> &model) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto query = controllers_.find(model->id());
+  if (query == controllers_.end()) {
+    return BatchController(config_.max_words, config_.target_latency).state();
+  }
+  return query->second.state();
+}
+
+TranslationCache::Stats Blocking::caching() const {
+  return cache_stats(cache_);
+}
+
+size_t Blocking::preload(const Ptr<Model> &model, const std::string &tsv) {
+  return store_ ? store_->preload(*model, tsv) : 0;
+}
+
+void Blocking::compact() {
+  if (store_) {
+    store_->compact();
+  }
+}
+
+// Replicas of models, one per NUMA node, each prepared by the first worker on
+// its node to ask for it, on that worker. They last as long as the model they
+// replicate, dropped at the first request for replicas after it goes.
+class Replicas {
+ public:
+  explicit Replicas(size_t nodes) : nodes_(nodes) {}
+
+  Ptr<Model> local(const Ptr<Model> &model, size_t node) {
+    std::promise<Ptr<Model>> promise;
+    std::shared_future<Ptr<Model>> replica;
+    bool preparing = false;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      // Replicas do not keep their origin alive, so that a registry can tell
+      // it idle. Released, its replicas go too.
+      std::erase_if(replicas_, [](const auto &entry) {
+        return entry.second.origin.expired();
+      });
+
+      Entry &entry = replicas_[model->id()];
+      if (entry.replicas.empty()) {
+        entry.origin = model;
+        entry.replicas.resize(nodes_);
+      }
+      replica = entry.replicas[node];
+      if (!replica.valid()) {
+        replica = promise.get_future().share();
+        entry.replicas[node] = replica;
+        preparing = true;
+      }
+    }
+
+    // Others on the node wait on the future rather than the lock, so that
+    // preparing does not hold up workers elsewhere.
+    if (preparing) {
+      try {
+        promise.set_value(Model::replicate(model));
+      } catch (const std::exception &e) {
+        // Batches waiting on this one translate with the origin, and the
+        // next to come tries again.
+        std::cerr << "[warn] Failed to replicate model on node " << node
+                  << ", translating with the original: " << e.what() << "\n";
+        {
+          std::lock_guard<std::mutex> guard(mutex_);
+          auto query = replicas_.find(model->id());
+          if (query != replicas_.end()) {
+            query->second.replicas[node] = std::shared_future<Ptr<Model>>();
+          }
+        }
+        promise.set_value(model);
+      }
+    }
+    return replica.get();
+  }
+
+ private:
+  struct Entry {
+    std::weak_ptr<Model> origin;
+    std::vector<std::shared_future<Ptr<Model>>> replicas;
+  };
+
+  size_t nodes_;
+  std::mutex mutex_;
+  std::unordered_map<size_t, Entry> replicas_;
+};
+
 Async::Async(const Config &config)
-    : cache_(make_cache(config.cache_size)),
+    : config_(config),
+      cache_(make_cache(config.cache_size)),
+      store_(make_store(config.cache_file)),
       batcher_(config.max_words, config.wrap_length,
-               config.tgt_length_limit_factor) {
+               config.tgt_length_limit_factor),
+      controller_(config.max_words, config.target_latency) {
+  if (config.preprocess_workers > 0) {
+    preprocess_ = std::make_unique<ThreadPool>(config.preprocess_workers);
+  }
+
+  // Replicas are only local to workers kept on their node.
+  std::string mode = config.pin;
+  if (config.replicate && mode.empty()) {
+    mode = "node";
+  }
+
+  Topology topology = Topology::detect();
+  if (config.replicate) {
+    replicas_ = std::make_unique<Replicas>(topology.nodes.size());
+  }
+
   // Also creates consumers, starts listening.
   for (size_t i = 0; i < config.workers; i++) {
-    workers_.emplace_back([this]() {
-      auto [batch, model] = batcher_.generate();
+    Placement placement = place(topology, mode, i);
+    workers_.emplace_back([this, i, placement]() {
+      Tracer::instance().name("worker " + std::to_string(i));
+      if (!placement.cpus.empty() && !pin(placement.cpus)) {
+        std::cerr << "[warn] Failed to pin worker, running unpinned.\n";
+      }
+
+      auto local = [this, node = placement.node](const Ptr<Model> &model) {
+        return replicas_ ? replicas_->local(model, node) : model;
+      };
+
+      if (config_.continuous) {
+        continuous(config_, batcher_, controller_, local);
+        return;
+      }
+
+      auto [batch, model] = batcher_.generate(controller_.budget());
       while (!batch.empty()) {
         // convert between batches.
-        Input input = convert(batch, model->vocabulary().pad_id(),
-                              config_.tgt_length_limit_factor);
-        Histories histories = model->forward(input);
-        batch.complete(histories);
-        auto [next_batch, next_model] = batcher_.generate();
+        {
+          // Scoped to leave waiting on the next batch out of the span.
+          Span span("batch");
+          annotate(span, batch);
+          Timer timer;
+          Input input = convert(batch, model->vocabulary().pad_id(),
+                                config_.tgt_length_limit_factor);
+          Histories histories = local(model)->forward(input);
+          double seconds = timer.elapsed();
+          controller_.record(batch.size() * batch.max_length(), seconds);
+          measure(input.occupancy(), input.words().size(), seconds);
+          batch.complete(histories);
+        }
+        auto [next_batch, next_model] = batcher_.generate(controller_.budget());
         batch = std::move(next_batch);
         model = std::move(next_model);
       }
@@ -228,53 +728,114 @@ Async::Async(const Config &config)
 
 Handle Async::translate(const Ptr<Model> &model, std::string source,
                         const Options &options) {
+  auto promise = std::make_shared<Promise>();
+  auto future = promise->get_future();
+  auto callback = [promise](Response &&response) {
+    promise->set_value(std::move(response));
+  };
+
+  auto request =
+      translate(model, std::move(source), options, std::move(callback));
+
+  constexpr size_t parts = 1;  // NOLINT
+  Handle handle(request, parts, std::move(future));
+  return handle;
+}
+
+std::shared_future<Ptr<Request>> Async::translate(const Ptr<Model> &model,
+                                                  std::string &&source,
+                                                  const Options &options,
+                                                  Callback callback) {
   std::shared_ptr<HTML> html = nullptr;
   if (options.html) {
     html = std::make_shared<HTML>(source);
   }
 
-  auto promise = std::make_shared<Promise>();
-  auto future = promise->get_future();
-  auto continuation = [html, promise](Response &&response) {
+  auto continuation = [html, callback = std::move(callback)](
+                          Response &&response) {
     if (html) {
       html->restore(response);
     }
-    promise->set_value(std::move(response));
+    callback(std::move(response));
     return nullptr;
   };
 
-  const TextProcessor &processor = model->processor();
-  auto [annotated, segments] =
-      processor.process(std::move(source), config_.wrap_length);
-  auto request = make_request(id(), model, cache_, std::move(annotated),
-                              std::move(segments), continuation);
+  return enqueue(model, std::move(source), std::move(continuation), options);
+}
 
-  batcher_.enqueue(model, request);
+std::shared_future<Ptr<Request>> Async::enqueue(
+    const Ptr<Model> &model, std::string &&source, Continuation continuation,
+    const Options &options) {
+  auto preprocess = [this, model, source = std::move(source),
+                     continuation = std::move(continuation),
+                     options]() mutable {
+    const TextProcessor &processor = model->processor();
+    auto [annotated, segments] =
+        preprocess_ ? processor.process(std::move(source), config_.wrap_length,
+                                        *preprocess_)
+                    : processor.process(std::move(source), config_.wrap_length);
+    auto request = make_request(id(), model, cache_, store_.get(),
+                                std::move(annotated), std::move(segments),
+                                std::move(continuation), options);
+
+    batcher_.enqueue(model, request);
+    return request;
+  };
 
-  constexpr size_t parts = 1;  // NOLINT
-  Handle handle(request, parts, std::move(future));
-  return handle;
+  if (preprocess_) {
+    return preprocess_->submit(std::move(preprocess)).share();
+  }
+
+  std::promise<Ptr<Request>> ready;
+  ready.set_value(preprocess());
+  return ready.get_future().share();
 }
 
 Handle Async::pivot(const Ptr<Model> &first, const Ptr<Model> &second,
                     std::string source, const Options &options) {
+  auto promise = std::make_shared<Promise>();
+  auto future = promise->get_future();
+  auto callback = [promise](Response &&response) {
+    promise->set_value(std::move(response));
+  };
+
+  auto request =
+      pivot(first, second, std::move(source), options, std::move(callback));
+
+  constexpr size_t parts = 2;  // NOLINT
+  Handle handle(request, parts, std::move(future));
+  return handle;
+}
+
+std::shared_future<Ptr<Request>> Async::pivot(const Ptr<Model> &first,
+                                              const Ptr<Model> &second,
+                                              std::string &&source,
+                                              const Options &options,
+                                              Callback callback) {
   Ptr<HTML> html = nullptr;
   if (options.html) {
     html = std::make_shared<HTML>(source);
   }
 
+  // Both stages are scheduled as the whole, the second stage with what
+  // remains of the deadline. Sentences are only reported as a Response.
+  Options staged{
+      .priority = options.priority,  //
+      .deadline = options.deadline   //
+  };
+  auto start = std::chrono::steady_clock::now();
+
   // This is callback chaining or CPS due to async.
-  auto promise = std::make_shared<Promise>();
-  auto future = promise->get_future();
+  auto continuation = [this, callback = std::move(callback), first, second,
+                       html, staged,
+                       start](Response &&partial) -> Ptr<Request> {
+    auto [annotated, segments] = handoff(*first, *second, partial);
 
-  auto continuation = [this, promise, second,
-                       html](Response &&partial) -> Ptr<Request> {
     // https://stackoverflow.com/a/65606554/4565794
     // Move semantics only work on mutable lambdas, and can only be done once.
     // It's only once in our case, so issok.
-    AnnotatedText intermediate = partial.target;
     auto joining_continuation =
-        [source_to_pivot = std::move(partial), promise,
+        [source_to_pivot = std::move(partial), callback,
          html](Response &&pivot_to_target) mutable -> Ptr<Request> {
       // We have both Responses at this callback, source_to_pivot is moved in,
       // second half will be available when complete.
@@ -285,35 +846,46 @@ Handle Async::pivot(const Ptr<Model> &first, const Ptr<Model> &second,
       if (html) {
         html->restore(response);
       }
-      promise->set_value(std::move(response));
+      callback(std::move(response));
       return nullptr;
     };
 
-    const TextProcessor &processor = second->processor();
-    auto [annotated, segments] = processor.process(intermediate);
+    Options remaining = staged;
+    if (staged.deadline != 0) {
+      auto elapsed = static_cast<size_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+      remaining.deadline =
+          elapsed < staged.deadline ? staged.deadline - elapsed : 1;
+    }
 
-    auto request =
-        make_request(id(), second, cache_, std::move(annotated),
-                     std::move(segments), std::move(joining_continuation));
+    auto request = make_request(id(), second, cache_, store_.get(),
+                                std::move(annotated), std::move(segments),
+                                std::move(joining_continuation), remaining);
 
     batcher_.enqueue(second, request);
     return request;
   };
 
-  const TextProcessor &processor = first->processor();
-  auto [annotated, segments] =
-      processor.process(std::move(source), config_.wrap_length);
-  auto request = make_request(id(), first, cache_, std::move(annotated),
-                              std::move(segments), continuation);
+  return enqueue(first, std::move(source), std::move(continuation), staged);
+}
+
+TranslationCache::Stats Async::caching() const { return cache_stats(cache_); }
 
-  batcher_.enqueue(first, request);
+size_t Async::preload(const Ptr<Model> &model, const std::string &tsv) {
+  return store_ ? store_->preload(*model, tsv) : 0;
+}
 
-  constexpr size_t parts = 2;  // NOLINT
-  Handle handle(request, parts, std::move(future));
-  return handle;
+void Async::compact() {
+  if (store_) {
+    store_->compact();
+  }
 }
 
 Async::~Async() {
+  // Preprocessing enqueues into batcher_, so has to finish before shutdown.
+  preprocess_.reset();
   batcher_.shutdown();
   for (std::thread &worker : workers_) {
     assert(worker.joinable());
@@ -322,4 +894,88 @@ Async::~Async() {
   workers_.clear();
 }
 
+Stream::Stream(Async &service, const Ptr<Model> &model,
+               const Options &options, Callback callback)
+    : Stream(service, model, nullptr, options, std::move(callback)) {}
+
+Stream::Stream(Async &service, const Ptr<Model> &first,
+               const Ptr<Model> &second, const Options &options,
+               Callback callback)
+    : service_(service),
+      first_(first),
+      second_(second),
+      options_(options),
+      callback_(std::move(callback)) {
+  // Markup may open in one piece and close in another, which HTML cannot
+  // restore across.
+  SLIMT_ABORT_IF(options_.html, "Streaming does not support HTML.");
+}
+
+Stream::~Stream() { close(); }
+
+void Stream::write(std::string_view text) {
+  pending_.append(text.data(), text.size());
+  const TextProcessor &processor = first_->processor();
+  size_t boundary = processor.boundary(pending_, scanned_);
+  if (boundary != 0) {
+    std::string ready = pending_.substr(0, boundary);
+    pending_.erase(0, boundary);
+    submit(std::move(ready));
+  }
+
+  // What remains is past the last boundary, so holds none.
+  scanned_ = pending_.size();
+}
+
+void Stream::close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+
+  if (!pending_.empty()) {
+    submit(std::move(pending_));
+    pending_.clear();
+    scanned_ = 0;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  drained_.wait(lock, [this]() { return delivered_ == submitted_; });
+}
+
+void Stream::submit(std::string &&text) {
+  size_t index;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    index = submitted_++;
+  }
+
+  // Responses may complete on this thread (empty text, or all cached), so the
+  // lock cannot be held here.
+  auto callback = [this, index](Response &&response) {
+    deliver(index, std::move(response));
+  };
+
+  if (second_) {
+    service_.pivot(first_, second_, std::move(text), options_,
+                   std::move(callback));
+  } else {
+    service_.translate(first_, std::move(text), options_, std::move(callback));
+  }
+}
+
+void Stream::deliver(size_t index, Response &&response) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  ready_.emplace(index, std::move(response));
+
+  // Holding the lock through callback_ keeps calls one at a time, in order.
+  auto next = ready_.begin();
+  while (next != ready_.end() && next->first == delivered_) {
+    callback_(std::move(next->second));
+    next = ready_.erase(next);
+    ++delivered_;
+  }
+  drained_.notify_all();
+}
+
 }  // namespace slimt
@@ -1,20 +1,32 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
+#include <functional>
 #include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "slimt/Batcher.hh"
 #include "slimt/Cache.hh"
 #include "slimt/Export.hh"
 #include "slimt/Response.hh"
+#include "slimt/Store.hh"
 #include "slimt/Types.hh"
 
 namespace slimt {
 
 class Model;
+class Replicas;
+class Request;
+class ThreadPool;
 struct Options;
 struct Response;
 
@@ -22,9 +34,15 @@ struct SLIMT_EXPORT Config {
   // NOLINTBEGIN
   size_t max_words = 1024;
   size_t cache_size = 1024;
+  std::string cache_file;
   size_t workers = 1;
   float tgt_length_limit_factor = 1.5;
   size_t wrap_length = 128;
+  size_t preprocess_workers = 0;
+  size_t target_latency = 0;
+  bool continuous = false;
+  std::string pin;
+  bool replicate = false;
   // NOLINTEND
 
   template <class App>
@@ -33,27 +51,83 @@ struct SLIMT_EXPORT Config {
     app.add_option("--limit-tgt", tgt_length_limit_factor, "Max length proportional to source target can have.");
     app.add_option("--max-words", max_words, "Maximum words in a batch.");
     app.add_option("--wrap-length", max_words, "Maximum length allowed for a sample, beyond which hard-wrap.");
+    app.add_option("--cache-file", cache_file, "File keeping translations across runs, appended to as segments translate.");
     app.add_option("--workers", workers, "Number of workers threads to launch for translating.");
+    app.add_option("--target-latency", target_latency, "Milliseconds a batch should take to translate, adapting batch size to suit. 0 keeps --max-words.");
+    app.add_flag("--continuous", continuous, "Decode with iteration-level batching: sentences join and leave a worker's batch between decoder steps (async only).");
+    app.add_option("--pin", pin, "Pin each worker to a core, cache domain (CCX) or NUMA node: core, cache or node. Workers go round-robin over nodes (async only).");
+    app.add_flag("--replicate", replicate, "Prepare a copy of each model's weights on every NUMA node, translating batches with the copy local to the worker. Pins workers to nodes unless --pin says otherwise (async only).");
+    app.add_option("--preprocess-workers", preprocess_workers, "Threads splitting and tokenizing input ahead of translation, 0 to do it on the calling thread.");
     // clang-format on
   }
 };
 
+/// Translates whole inputs in one call, returning Responses in the order of
+/// sources. Batches are generated on the calling thread and translated
+/// there and on workers - 1 more threads, a batch each at a time.
 class SLIMT_EXPORT Blocking {
  public:
+  constexpr static size_t kWindow = 1024;
+
   explicit Blocking(const Config &config);
+  ~Blocking();
+
   std::vector<Response> translate(const Ptr<Model> &model,
                                   std::vector<std::string> sources,
                                   const Options &options);
+
+  /// Reads a source into its argument, returning false once there are none.
+  using Reader = std::function<bool(std::string &source)>;
+  using Writer = std::function<void(Response &&response)>;
+
+  /// Translates sources from read as they are needed, and hands each
+  /// Response to write in the order read, as soon as it and every Response
+  /// before it are complete. At most window sources are held at once, so
+  /// memory stays bounded however many there are.
+  /// @returns number of Responses written.
+  size_t translate(const Ptr<Model> &model, const Reader &read,
+                   const Writer &write, const Options &options,
+                   size_t window = kWindow);
+
+  /// Translates sources through first, then second. Each source is handed
+  /// to second as soon as first completes it, so that workers translate
+  /// batches of both at once.
   std::vector<Response> pivot(const Ptr<Model> &first, const Ptr<Model> &second,
                               std::vector<std::string> sources,
                               const Options &options);
 
+  /// Current state of batch size adaptation for model, which each Model
+  /// has of its own, as their batches differ in cost.
+  BatchController::State batching(const Ptr<Model> &model) const;
+
+  /// Translation cache counters, all zero with caching disabled.
+  TranslationCache::Stats caching() const;
+
+  /// Adds a translation memory of tab-separated source and target segments
+  /// to the cache file, for model.
+  /// @returns number of segments added, 0 without a cache file.
+  size_t preload(const Ptr<Model> &model, const std::string &tsv);
+
+  /// Rewrites the cache file without translations since superseded.
+  void compact();
+
  private:
   size_t id() { return id_++; }
 
+  /// Controller adapting batch size for model, made on first use.
+  BatchController &controller(const Model &model);
+
   Config config_;
   std::optional<TranslationCache> cache_;
-  size_t id_ = 0;
+  std::unique_ptr<TranslationStore> store_;
+  std::unique_ptr<ThreadPool> pool_;
+
+  // By Model::id(). Nodes stay put, so references to them stay valid.
+  std::unordered_map<size_t, BatchController> controllers_;
+  mutable std::mutex mutex_;
+
+  // Continuations make requests too, on whichever thread completes a batch.
+  std::atomic<size_t> id_ = 0;
 };
 
 class SLIMT_EXPORT Async {
@@ -61,20 +135,123 @@ class SLIMT_EXPORT Async {
   explicit Async(const Config &config);
   ~Async();
 
+  /// Translates source in the background. Its sentences are batched with
+  /// those of other pending requests, across models, in the order
+  /// Options::priority describes.
   Handle translate(const Ptr<Model> &model, std::string source,
                    const Options &options);
   Handle pivot(const Ptr<Model> &first, const Ptr<Model> &second,
                std::string source, const Options &options);
 
+  /// Current state of batch size adaptation.
+  BatchController::State batching() const { return controller_.state(); }
+
+  /// Translation cache counters, all zero with caching disabled.
+  TranslationCache::Stats caching() const;
+
+  /// Adds a translation memory of tab-separated source and target segments
+  /// to the cache file, for model.
+  /// @returns number of segments added, 0 without a cache file.
+  size_t preload(const Ptr<Model> &model, const std::string &tsv);
+
+  /// Rewrites the cache file without translations since superseded.
+  void compact();
+
  private:
+  friend class Stream;
+
   size_t id() { return id_++; }
 
+  /// As the public counterparts, but hand the Response to callback on
+  /// completion instead of through a Handle.
+  using Callback = std::function<void(Response &&)>;
+  std::shared_future<Ptr<Request>> translate(const Ptr<Model> &model,
+                                             std::string &&source,
+                                             const Options &options,
+                                             Callback callback);
+  std::shared_future<Ptr<Request>> pivot(const Ptr<Model> &first,
+                                         const Ptr<Model> &second,
+                                         std::string &&source,
+                                         const Options &options,
+                                         Callback callback);
+
+  /// Runs preprocess on the preprocessing pool if there is one, or on the
+  /// calling thread otherwise. Either way, produces the Request it enqueues.
+  using Continuation = std::function<Ptr<Request>(Response &&)>;
+  std::shared_future<Ptr<Request>> enqueue(
+      const Ptr<Model> &model, std::string &&source, Continuation continuation,
+      const Options &options);
+
   Config config_;
   std::optional<TranslationCache> cache_;
+  std::unique_ptr<TranslationStore> store_;
   Threadsafe<AggregateBatcher> batcher_;
+  BatchController controller_;
   std::vector<std::thread> workers_;
+  std::unique_ptr<ThreadPool> preprocess_;
+  std::unique_ptr<Replicas> replicas_;
+
+  std::atomic<size_t> id_ = 0;
+};
+
+/// Stream translates text that arrives incrementally, such as from a pipe.
+///
+/// Text written is held until it reaches a point no sentence continues past
+/// (a line, or a paragraph for wrapped text). Everything up to there is then
+/// translated as a request of its own, so sentences reach the batcher as soon
+/// as their boundary is known rather than at the end of input. close() sends
+/// whatever remains.
+///
+/// Responses are handed to callback in the order their text was written, one
+/// at a time, on whichever thread completes them. Concatenating their target
+/// texts gives the translation of all text written. callback must not call
+/// back into the Stream.
+class SLIMT_EXPORT Stream {
+ public:
+  using Callback = std::function<void(Response &&)>;
+
+  Stream(Async &service, const Ptr<Model> &model, const Options &options,
+         Callback callback);
+
+  /// Pivots through first and second, as Async::pivot, unless second is null.
+  Stream(Async &service, const Ptr<Model> &first, const Ptr<Model> &second,
+         const Options &options, Callback callback);
+
+  /// Closes, if not already closed.
+  ~Stream();
+
+  Stream(const Stream &) = delete;
+  Stream &operator=(const Stream &) = delete;
+
+  void write(std::string_view text);
+
+  /// Translates any text held back, and waits until every Response written
+  /// for has been handed to callback.
+  void close();
+
+ private:
+  void submit(std::string &&text);
+  void deliver(size_t index, Response &&response);
+
+  Async &service_;
+  Ptr<Model> first_;
+  Ptr<Model> second_;
+  Options options_;
+  Callback callback_;
+
+  // Text written past the last boundary, yet to be submitted, and how much of
+  // it has been searched for a boundary, so that writes in small pieces do
+  // not search it all again each time.
+  std::string pending_;
+  size_t scanned_ = 0;
+  bool closed_ = false;
 
-  size_t id_ = 0;
+  size_t submitted_ = 0;
+  size_t delivered_ = 0;
+  // Responses completed out of order, waiting on those written before them.
+  std::map<size_t, Response> ready_;
+  std::mutex mutex_;
+  std::condition_variable drained_;
 };
 
 }  // namespace slimt
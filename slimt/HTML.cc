@@ -14,6 +14,7 @@
 
 #include "slimt/Annotation.hh"
 #include "slimt/Macros.hh"
+#include "slimt/Metrics.hh"
 #include "slimt/Response.hh"
 #include "slimt/Types.hh"
 #include "slimt/XHScanner.hh"
@@ -563,6 +564,8 @@ void HTML::restore(Response &response) {
   // TODO(any): replace this with optional<HTML> at a higher level
   if (spans_.empty()) return;
 
+  Metrics::Scope scope(Stage::kHTML);
+
   // We need alignment info to transfer the HTML tags from the input to the
   // translation. If those are not available, no HTML in translations for you.
   SLIMT_ABORT_IF(
@@ -64,7 +64,7 @@ void Input::finalize() {
 
 float Input::limit_factor() const { return limit_factor_; }
 
-float Input::occupancy() {
+float Input::occupancy() const {
   size_t sequence_length = batch_.dim(-1);
   size_t batch_size = batch_.dim(-2);
   return used_ / static_cast<float>(batch_size * sequence_length);
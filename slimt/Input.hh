@@ -20,7 +20,7 @@ class Input {
   const std::vector<uint32_t> &words() const { return words_; }
   const std::vector<size_t> &lengths() const { return lengths_; }
   size_t index() const { return index_; }
-  float occupancy();
+  float occupancy() const;
   float limit_factor() const;
 
  private:
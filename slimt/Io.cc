@@ -5,12 +5,17 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <bit>
 #include <cassert>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -111,7 +116,7 @@ void set_item(Item& item, Aligned&& aligned) {
   };
 }
 
-std::vector<io::Item> load_items(void* current) {
+std::vector<io::Item> load_items(void* current, const Shared* shared) {
   uint64_t binary_file_version = *emit<uint64_t>(current);
   if (binary_file_version != kBinaryFileVersion) {
     std::cerr << "Binary file versions do not match: ";
@@ -155,6 +160,18 @@ std::vector<io::Item> load_items(void* current) {
   // Keep an extra item for embedding processed.
   Item embedding_processed;
 
+  // Points item to a prepared copy published by another process, if any.
+  auto from_shared = [shared](Item& item) {
+    const Item* prepared = shared ? shared->find(item.name) : nullptr;
+    if (prepared == nullptr) {
+      return false;
+    }
+    item.view = prepared->view;
+    item.type = prepared->type;
+    item.shape = prepared->shape;
+    return true;
+  };
+
   for (uint64_t i = 0; i < num_headers; ++i) {
     Item& item = items[i];
     uint64_t size = headers[i].data_length;
@@ -180,6 +197,11 @@ std::vector<io::Item> load_items(void* current) {
             .size = size  //
         };
       } else if (item.name == "Wemb") {  // NOLINT
+        embedding_processed.name = "Wemb_intgemm8";
+        if (from_shared(item) && from_shared(embedding_processed)) {
+          continue;
+        }
+
         size_t num_elements = item.shape.elements();
         // At the end of items is the quantization multiplier.So we do some
         // pointer arithmetic to move ahead of the elements to extract the
@@ -204,7 +226,6 @@ std::vector<io::Item> load_items(void* current) {
         assert((rows * cols) % 8 == 0);
 
         // PrepareB and write.
-        embedding_processed.name = "Wemb_intgemm8";
         embedding_processed.shape = Shape({cols, rows});
         embedding_processed.type = Type::i8;
         size_t prepared_size =
@@ -222,7 +243,7 @@ std::vector<io::Item> load_items(void* current) {
 
         // SLIMT_TRACE(embedding_processed.shape);
         set_item(embedding_processed, std::move(embedding_aligned));
-      } else {
+      } else if (!from_shared(item)) {
         // The matrix has to be processed to the format expected by intgemm.
         size_t rows = item.shape.dim(-2);
         size_t cols = item.shape.dim(-1);
@@ -282,6 +303,38 @@ void unquantize_embedding_weights(const int8_t* quantized_weights,
   }
 }
 
+uint64_t digest(View blob) {
+  // Eight bytes a step, multiplied and rotated in, so that hashing a model
+  // costs a fraction of loading it. The tail is zero padded into one more
+  // word, and the size mixed in tells apart blobs differing in trailing zeros.
+  constexpr uint64_t kMultiplier = 0x9e3779b97f4a7c15;
+  constexpr uint64_t kPrime = 0x100000001b3;
+
+  uint64_t hash = 0xcbf29ce484222325 ^ blob.size;
+  auto mix = [&hash](uint64_t word) {
+    hash = std::rotl(hash ^ (word * kMultiplier), 29) * kPrime;
+  };
+
+  const char* data = reinterpret_cast<const char*>(blob.data);
+  size_t whole = blob.size / sizeof(uint64_t) * sizeof(uint64_t);
+  for (size_t offset = 0; offset < whole; offset += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + offset, sizeof(word));
+    mix(word);
+  }
+  if (whole < blob.size) {
+    uint64_t word = 0;
+    std::memcpy(&word, data + whole, blob.size - whole);
+    mix(word);
+  }
+
+  // Spreads the last words across every bit.
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccd;
+  hash ^= hash >> 33;
+  return hash;
+}
+
 std::ostream& operator<<(std::ostream& out, const Item& item) {
   out << "Item(" << item.name << ", ";
   out << to_string(item.type) << ", ";
@@ -344,4 +397,156 @@ void MmapFile::reset() {
   size_ = 0;
 }
 
+Shared::Shared(const std::string& path) {
+  if (access(path.c_str(), R_OK) == -1) {
+    return;
+  }
+
+  MmapFile file(path);
+  char* begin = reinterpret_cast<char*>(file.data());
+  size_t offset = 0;
+
+  // Every length comes from the file, so is checked against what remains of
+  // it before use. A truncated or corrupt file is ignored, not read past.
+  auto take = [&file, begin, &offset](uint64_t size) -> char* {
+    if (size > file.size() - offset) {
+      return nullptr;
+    }
+    char* head = begin + offset;
+    offset += size;
+    return head;
+  };
+
+  // Fields follow strings of any length, so need not be aligned.
+  auto read = [&take](auto& value) {
+    const char* head = take(sizeof(value));
+    if (head != nullptr) {
+      std::memcpy(&value, head, sizeof(value));
+    }
+    return head != nullptr;
+  };
+
+  auto align = [&take, &offset]() {
+    return take((kAlignWidth - offset % kAlignWidth) % kAlignWidth) != nullptr;
+  };
+
+  auto ignore = [&path](const char* reason) {
+    std::cerr << "Ignoring shared weights " << path << ": " << reason << ".\n";
+  };
+
+  uint64_t magic = 0;
+  if (!read(magic) || magic != kMagic) {
+    ignore("bad magic");
+    return;
+  }
+
+  uint64_t fingerprint = 0;
+  uint64_t build_length = 0;
+  const char* build = nullptr;
+  uint64_t count = 0;
+  if (!read(fingerprint) || !read(build_length) ||
+      (build = take(build_length)) == nullptr || !read(count)) {
+    ignore("truncated");
+    return;
+  }
+
+  std::unordered_map<std::string, Item> items;
+  for (uint64_t i = 0; i < count; i++) {
+    Header header{};
+    const char* name = nullptr;
+    if (!read(header) || (name = take(header.name_length)) == nullptr ||
+        header.shape_length > file.size() / sizeof(uint64_t)) {
+      ignore("truncated");
+      return;
+    }
+
+    std::vector<uint64_t> dims(header.shape_length);
+    const char* shape = take(header.shape_length * sizeof(uint64_t));
+    char* data = nullptr;
+    if (shape == nullptr || !align() ||
+        (data = take(header.data_length)) == nullptr) {
+      ignore("truncated");
+      return;
+    }
+    std::memcpy(dims.data(), shape, dims.size() * sizeof(uint64_t));
+
+    Item item;
+    item.name = std::string(name, header.name_length);
+    item.type = static_cast<Type>(header.type);
+    item.shape = Shape(std::move(dims));
+    item.view = View{
+        .data = data,               //
+        .size = header.data_length  //
+    };
+    items.emplace(item.name, std::move(item));
+  }
+
+  fingerprint_ = fingerprint;
+  build_ = std::string(build, build_length);
+  items_ = std::move(items);
+  file_ = std::move(file);
+}
+
+const Item* Shared::find(const std::string& name) const {
+  auto query = items_.find(name);
+  return query != items_.end() ? &query->second : nullptr;
+}
+
+void Shared::publish(const std::string& path, uint64_t fingerprint,
+                     const std::string& build,
+                     const std::vector<Item>& items) {
+  std::string staging = path + ".tmp." + std::to_string(getpid());
+  std::ofstream out(staging, std::ios::binary);
+  if (!out) {
+    std::cerr << "Failed to publish shared weights to " << staging << "\n";
+    return;
+  }
+
+  auto write = [&out](const void* data, size_t size) {
+    out.write(reinterpret_cast<const char*>(data),
+              static_cast<std::streamsize>(size));
+  };
+
+  auto align = [&out, &write]() {
+    static const char zeros[kAlignWidth] = {};
+    size_t offset = static_cast<size_t>(out.tellp());
+    write(zeros, (kAlignWidth - offset % kAlignWidth) % kAlignWidth);
+  };
+
+  // Only items that own storage were prepared, the rest point into the blob.
+  uint64_t count = 0;
+  for (const Item& item : items) {
+    count += item.aligned.size() != 0 ? 1 : 0;
+  }
+
+  write(&kMagic, sizeof(kMagic));
+  write(&fingerprint, sizeof(fingerprint));
+  uint64_t build_length = build.size();
+  write(&build_length, sizeof(build_length));
+  write(build.data(), build.size());
+  write(&count, sizeof(count));
+  for (const Item& item : items) {
+    if (item.aligned.size() == 0) {
+      continue;
+    }
+    Header header{
+        .name_length = item.name.size(),           //
+        .type = static_cast<uint64_t>(item.type),  //
+        .shape_length = item.shape.size(),         //
+        .data_length = item.view.size              //
+    };
+    write(&header, sizeof(header));
+    write(item.name.data(), item.name.size());
+    write(item.shape.dims().data(), item.shape.size() * sizeof(uint64_t));
+    align();
+    write(item.view.data, item.view.size);
+  }
+
+  out.close();
+  if (!out || std::rename(staging.c_str(), path.c_str()) != 0) {
+    std::cerr << "Failed to publish shared weights to " << path << "\n";
+    std::remove(staging.c_str());
+  }
+}
+
 }  // namespace slimt::io
@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <iosfwd>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "slimt/Aligned.hh"
@@ -41,9 +42,19 @@ using Items = std::vector<Item>;
 
 void set_item(Item& item, Aligned&& aligned);
 
-std::vector<io::Item> load_items(void* current);
+class Shared;
+
+/// Loads items from a model blob, preparing quantized matrices into the layout
+/// the matrix-multiply provider expects. If shared is supplied, prepared items
+/// found there are pointed to in place of being prepared again.
+std::vector<io::Item> load_items(void* current,
+                                 const Shared* shared = nullptr);
 std::ostream& operator<<(std::ostream& out, const Item& item);
 
+/// Hash of every byte of a blob, so that any change to the blob changes it. It
+/// keys what outlives the process: prepared weights and stored translations.
+uint64_t digest(View blob);
+
 void unquantize_embedding_weights(const int8_t* quantized_weights,
                                   float quantization_multiplier, size_t size,
                                   float* weights);
@@ -74,6 +85,44 @@ class MmapFile {
   size_t size_ = 0;
 };
 
+/// Prepared weights published by one process into a file, ideally on a tmpfs
+/// like /dev/shm, for other processes to map read-only instead of preparing
+/// and holding their own copies.
+///
+/// Layout: magic, digest of the source blob, length and bytes of the
+/// build string, number of items, followed by each item as a Header, name,
+/// shape and data aligned to kAlignWidth.
+///
+/// Prepared layouts depend on the matrix-multiply provider, the instruction
+/// set it dispatched to and the model config. The publisher records these as
+/// the build string, which attaching processes compare against their own.
+class Shared {
+ public:
+  constexpr static uint64_t kMagic = 0x534C494D54534857;
+
+  Shared() = default;
+
+  /// Maps the file at path if it exists, leaving this detached otherwise.
+  explicit Shared(const std::string& path);
+
+  bool attached() const { return file_.data() != nullptr; }
+  uint64_t fingerprint() const { return fingerprint_; }
+  const std::string& build() const { return build_; }
+  const Item* find(const std::string& name) const;
+
+  /// Writes items owning prepared storage to path. The file is written
+  /// under a temporary name and renamed, so readers never see it partial.
+  static void publish(const std::string& path, uint64_t fingerprint,
+                      const std::string& build,
+                      const std::vector<Item>& items);
+
+ private:
+  MmapFile file_;
+  uint64_t fingerprint_ = 0;
+  std::string build_;
+  std::unordered_map<std::string, Item> items_;
+};
+
 }  // namespace io
 
 }  // namespace slimt
@@ -0,0 +1,181 @@
+#include "slimt/Metrics.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace slimt {
+
+namespace {
+
+constexpr double kFirstSeconds = 1e-5;
+constexpr double kFractionStep = 0.05;
+constexpr double kFirstRate = 10;
+constexpr double kNano = 1e-9;
+
+uint64_t now() {
+  auto since = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(since).count();
+}
+
+struct Description {
+  const char *name;
+  const char *help;
+};
+
+// In order of Stage.
+constexpr Description kStages[] = {
+    {"queue", "Segment enqueued until taken into a batch."},        //
+    {"preprocess", "Splitting and tokenizing a source."},           //
+    {"shortlist", "Generating the shortlists of a batch."},         //
+    {"encode", "Encoder forward of a batch."},                      //
+    {"decode_step", "One decoder step of a batch."},                //
+    {"detokenize", "Decoding the target words of a segment."},      //
+    {"html_restore", "Restoring markup into a response."},          //
+    {"cache_hit", "Lookup of a segment found in cache or store."},  //
+};
+
+static_assert(std::size(kStages) == static_cast<size_t>(Stage::kCount));
+
+// In order of Measure, names in full.
+constexpr Description kMeasures[] = {
+    {"slimt_batch_occupancy_ratio",
+     "Fraction of a batch's padded tokens that are words."},
+    {"slimt_batch_words_per_second",
+     "Source words a batch translates, per second."},
+};
+
+static_assert(std::size(kMeasures) == static_cast<size_t>(Measure::kCount));
+
+void write(std::ostream &out, const std::string &metric, const char *help,
+           const Histogram &histogram) {
+  Histogram::Snapshot snapshot = histogram.snapshot();
+  out << "# HELP " << metric << " " << help << "\n";
+  out << "# TYPE " << metric << " histogram\n";
+
+  // Prometheus buckets are cumulative.
+  uint64_t cumulative = 0;
+  for (size_t bucket = 0; bucket < Histogram::kBuckets; bucket++) {
+    cumulative += snapshot.counts[bucket];
+    out << metric << "_bucket{le=\"" << histogram.bound(bucket) << "\"} "
+        << cumulative << "\n";
+  }
+  out << metric << "_bucket{le=\"+Inf\"} " << snapshot.count << "\n";
+  out << metric << "_sum " << snapshot.sum << "\n";
+  out << metric << "_count " << snapshot.count << "\n";
+}
+
+}  // namespace
+
+double Histogram::bound(Scale scale, size_t bucket) {
+  if (scale == Scale::kFraction) {
+    return kFractionStep * static_cast<double>(bucket);
+  }
+  auto doubled = static_cast<double>(uint64_t{1} << bucket);
+  return (scale == Scale::kRate ? kFirstRate : kFirstSeconds) * doubled;
+}
+
+void Histogram::record(double value) {
+  size_t bucket = 0;
+  while (bucket < kBuckets && value > bound(bucket)) {
+    ++bucket;
+  }
+  counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  // fetch_add on doubles is not in every standard library yet.
+  double sum = sum_.load(std::memory_order_relaxed);
+  while (!sum_.compare_exchange_weak(sum, sum + value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+void Histogram::reset() {
+  for (std::atomic<uint64_t> &count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  sum_.store(0, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snapshot{.scale = scale_, .counts = {}, .count = 0, .sum = 0};
+  for (const std::atomic<uint64_t> &count : counts_) {
+    uint64_t value = count.load(std::memory_order_relaxed);
+    snapshot.counts.push_back(value);
+    snapshot.count += value;
+  }
+  snapshot.sum = sum_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+double Histogram::Snapshot::quantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  // Rank of the quantile, then the bucket it falls in, assuming values spread
+  // evenly between the bounds of that bucket.
+  double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(count);
+  double below = 0;
+  for (size_t bucket = 0; bucket < counts.size(); bucket++) {
+    auto here = static_cast<double>(counts[bucket]);
+    if (here > 0 && below + here >= rank) {
+      if (bucket == kBuckets) {
+        return bound(scale, kBuckets - 1);
+      }
+      double lower = bucket == 0 ? 0 : bound(scale, bucket - 1);
+      double upper = bound(scale, bucket);
+      return lower + (upper - lower) * (rank - below) / here;
+    }
+    below += here;
+  }
+  return bound(scale, kBuckets - 1);
+}
+
+Metrics &Metrics::instance() {
+  static Metrics metrics;
+  return metrics;
+}
+
+const char *Metrics::name(Stage stage) {
+  return kStages[static_cast<size_t>(stage)].name;
+}
+
+const char *Metrics::name(Measure measure) {
+  return kMeasures[static_cast<size_t>(measure)].name;
+}
+
+std::string Metrics::prometheus() const {
+  std::ostringstream out;
+  for (size_t i = 0; i < histograms_.size(); i++) {
+    const Description &stage = kStages[i];
+    std::string metric = std::string("slimt_") + stage.name + "_seconds";
+    write(out, metric, stage.help, histograms_[i]);
+  }
+  for (size_t i = 0; i < measures_.size(); i++) {
+    write(out, kMeasures[i].name, kMeasures[i].help, measures_[i]);
+  }
+  return out.str();
+}
+
+void Metrics::reset() {
+  for (Histogram &histogram : histograms_) {
+    histogram.reset();
+  }
+  for (Histogram &histogram : measures_) {
+    histogram.reset();
+  }
+}
+
+Metrics::Scope::Scope(Stage stage) : stage_(stage), start_(now()) {}
+
+Metrics::Scope::~Scope() {
+  double seconds = static_cast<double>(now() - start_) * kNano;
+  Metrics::instance()[stage_].record(seconds);
+}
+
+}  // namespace slimt
@@ -0,0 +1,134 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "slimt/Export.hh"
+
+namespace slimt {
+
+/// Stages of translation Metrics times.
+enum class Stage : size_t {
+  kQueue,       ///< Segment enqueued until taken into a batch.
+  kPreprocess,  ///< Splitting and tokenizing a source.
+  kShortlist,   ///< Generating the shortlists of a batch.
+  kEncode,      ///< Encoder forward of a batch.
+  kDecodeStep,  ///< One decoder step of a batch.
+  kDetokenize,  ///< Decoding the target words of a segment into text.
+  kHTML,        ///< Restoring markup into a Response.
+  kCacheHit,    ///< Lookup of a segment found in cache or store.
+  kCount
+};
+
+/// Measures of each batch Metrics records, besides how long stages take.
+enum class Measure : size_t {
+  kOccupancy,       ///< Fraction of a batch's padded tokens that are words.
+  kWordsPerSecond,  ///< Source words a batch translates, per second.
+  kCount
+};
+
+/// Values in buckets, with a last bucket for anything above the others.
+/// Recording takes no lock, so workers record concurrently without contending
+/// beyond the cache line.
+class SLIMT_EXPORT Histogram {
+ public:
+  constexpr static size_t kBuckets = 21;
+
+  /// How bucket bounds space out.
+  enum class Scale {
+    kSeconds,   ///< From 10us doubling up to about 10s.
+    kFraction,  ///< From 0 to 1 in steps of 0.05.
+    kRate,      ///< From 10 doubling up to about 10M.
+  };
+
+  explicit Histogram(Scale scale = Scale::kSeconds) : scale_(scale) {}
+
+  /// Upper bound of bucket under scale, inclusive.
+  static double bound(Scale scale, size_t bucket);
+  double bound(size_t bucket) const { return bound(scale_, bucket); }
+
+  void record(double value);
+  void reset();
+
+  struct Snapshot {
+    Scale scale;                   ///< Of the Histogram taken from.
+    std::vector<uint64_t> counts;  ///< Per bucket, kBuckets + 1 of them.
+    uint64_t count;                ///< Values recorded.
+    double sum;                    ///< Over all values.
+
+    /// Upper bound of the bucket holding quantile q, in [0, 1], interpolated
+    /// within it. 0 if nothing is recorded.
+    double quantile(double q) const;
+  };
+
+  /// Counts at one point in time, though recordings racing with it may show
+  /// in some fields and not others.
+  Snapshot snapshot() const;
+
+ private:
+  Scale scale_;
+  std::array<std::atomic<uint64_t>, kBuckets + 1> counts_{};
+  std::atomic<double> sum_ = 0;
+};
+
+/// Latency of each Stage, and each Measure of batches, across every service
+/// in the process.
+class SLIMT_EXPORT Metrics {
+ public:
+  static Metrics &instance();
+
+  Histogram &operator[](Stage stage) {
+    return histograms_[static_cast<size_t>(stage)];
+  }
+
+  const Histogram &operator[](Stage stage) const {
+    return histograms_[static_cast<size_t>(stage)];
+  }
+
+  Histogram &operator[](Measure measure) {
+    return measures_[static_cast<size_t>(measure)];
+  }
+
+  const Histogram &operator[](Measure measure) const {
+    return measures_[static_cast<size_t>(measure)];
+  }
+
+  /// Name of stage in exported metrics, as slimt_<name>_seconds.
+  static const char *name(Stage stage);
+
+  /// Name of measure in exported metrics, in full.
+  static const char *name(Measure measure);
+
+  /// Every histogram in the Prometheus text exposition format.
+  std::string prometheus() const;
+
+  void reset();
+
+  /// Records the time from construction to destruction into a stage.
+  class Scope {
+   public:
+    explicit Scope(Stage stage);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   private:
+    Stage stage_;
+    uint64_t start_;
+  };
+
+ private:
+  Metrics() = default;
+
+  std::array<Histogram, static_cast<size_t>(Stage::kCount)> histograms_;
+  std::array<Histogram, static_cast<size_t>(Measure::kCount)> measures_{
+      Histogram(Histogram::Scale::kFraction),  //
+      Histogram(Histogram::Scale::kRate),      //
+  };
+};
+
+}  // namespace slimt
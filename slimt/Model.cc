@@ -1,9 +1,14 @@
 #include "slimt/Model.hh"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <iostream>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <string>
 #include <utility>
@@ -12,18 +17,22 @@
 #include "slimt/Aligned.hh"
 #include "slimt/Input.hh"
 #include "slimt/Io.hh"
+#include "slimt/Metrics.hh"
+#include "slimt/Trace.hh"
 #include "slimt/Shortlist.hh"
 #include "slimt/Tensor.hh"
 #include "slimt/TensorOps.hh"
 #include "slimt/Transformer.hh"
 #include "slimt/Types.hh"
+#include "slimt/Utils.hh"
 #include "slimt/Vocabulary.hh"
 
 namespace slimt {
 
 namespace {
 
-size_t model_id = 0;
+// Models load concurrently, on registry and replicating threads.
+std::atomic<size_t> model_id = 0;
 
 Package<io::MmapFile> mmap_from(const Package<std::string> &package) {
   auto maybe_mmap = [](const std::string &path) {
@@ -47,30 +56,88 @@ Package<View> view_from(const Package<io::MmapFile> &mmap) {
   };
 }
 
+uint64_t fingerprint_of(const Package<View> &view) {
+  uint64_t seed = io::digest(view.model);
+  hash_combine<uint64_t>(seed, io::digest(view.vocabulary));
+  hash_combine<uint64_t>(seed, io::digest(view.shortlist));
+  return seed;
+}
+
 }  // namespace
 
 Model::Model(const Config &config, const Package<View> &package)
-    : id_(model_id++),
+    : id_(model_id.fetch_add(1)),
       config_(config),
       view_(package),
-      vocabulary_(package.vocabulary),
-      processor_(config.split_mode, vocabulary_, Aligned()),
+      fingerprint_(std::make_shared<Fingerprint>()),
+      vocabulary_(std::make_shared<const Vocabulary>(package.vocabulary)),
+      processor_(config.split_mode, *vocabulary_, Aligned()),
       transformer_(config.encoder_layers, config.decoder_layers,
-                   config.num_heads, config.feed_forward_depth, package.model),
+                   config.num_heads, config.feed_forward_depth, package.model,
+                   config.shared_weights),
       shortlist_generator_(make_shortlist_generator(
-          package.shortlist, vocabulary_, vocabulary_)) {}
+          package.shortlist, *vocabulary_, *vocabulary_)) {}
 
 Model::Model(const Config &config, const Package<std::string> &package)
-    : id_(model_id++),
+    : id_(model_id.fetch_add(1)),
       config_(config),
-      mmap_(mmap_from(package)),
+      mmap_(std::make_shared<const Mmap>(mmap_from(package))),
       view_(view_from(*mmap_)),
-      vocabulary_(view_.vocabulary),
-      processor_(config.split_mode, vocabulary_, Aligned()),
+      fingerprint_(std::make_shared<Fingerprint>()),
+      vocabulary_(std::make_shared<const Vocabulary>(view_.vocabulary)),
+      processor_(config.split_mode, *vocabulary_, Aligned()),
+      transformer_(config.encoder_layers, config.decoder_layers,
+                   config.num_heads, config.feed_forward_depth, view_.model,
+                   config.shared_weights),
+      shortlist_generator_(make_shortlist_generator(
+          view_.shortlist, *vocabulary_, *vocabulary_)) {}
+
+Model::Model(const Config &config, const Model &origin)
+    : id_(model_id.fetch_add(1)),
+      config_(config),
+      mmap_(origin.mmap_),
+      view_(origin.view_),
+      fingerprint_(origin.fingerprint_),
+      vocabulary_(origin.vocabulary_),
+      processor_(config.split_mode, *vocabulary_, Aligned()),
       transformer_(config.encoder_layers, config.decoder_layers,
-                   config.num_heads, config.feed_forward_depth, view_.model),
+                   config.num_heads, config.feed_forward_depth, view_.model,
+                   config.shared_weights),
       shortlist_generator_(make_shortlist_generator(
-          view_.shortlist, vocabulary_, vocabulary_)) {}
+          view_.shortlist, *vocabulary_, *vocabulary_)) {}
+
+uint64_t Model::fingerprint() const {
+  Fingerprint &fingerprint = *fingerprint_;
+  std::call_once(fingerprint.once, [this, &fingerprint]() {
+    fingerprint.value = fingerprint_of(view_);
+  });
+  return fingerprint.value;
+}
+
+size_t Model::footprint() const {
+  size_t bytes = transformer_.footprint();
+  bytes += view_.model.size;
+  bytes += view_.vocabulary.size;
+  bytes += view_.shortlist.size;
+  bytes += view_.ssplit.size;
+  return bytes;
+}
+
+Ptr<Model> Model::replicate(const Ptr<Model> &model) {
+  Config config = model->config_;
+  config.shared_weights.clear();
+  return Ptr<Model>(new Model(config, *model));
+}
+
+bool Model::shares_vocabulary(const Model &other) const {
+  // Comparing the bytes is cheap beside translating, and unlike fingerprints
+  // exact.
+  const View &mine = view_.vocabulary;
+  const View &theirs = other.view_.vocabulary;
+  return mine.size == theirs.size &&
+         (mine.data == theirs.data ||
+          std::memcmp(mine.data, theirs.data, mine.size) == 0);
+}
 
 std::optional<ShortlistGenerator> Model::make_shortlist_generator(
     View view, const Vocabulary &source, const Vocabulary &target) {
@@ -113,17 +180,30 @@ Histories Model::decode(const Tensor &encoder_out, const Input &input) const {
   size_t batch_size = encoder_out.dim(-3);
   size_t source_sequence_length = encoder_out.dim(-2);
 
+  // With a group size configured, each group of consecutive sentences gets a
+  // shortlist of its own, which stays small however large the batch grows.
+  size_t group_size = config_.shortlist_group_size;
   std::optional<Words> indices = std::nullopt;
+  std::vector<Words> groups;
   if (shortlist_generator_) {
-    Shortlist shortlist = shortlist_generator_->generate(input.words());
-    indices = shortlist.words();
+    Metrics::Scope scope(Stage::kShortlist);
+    if (group_size == 0 || group_size >= batch_size) {
+      Shortlist shortlist = shortlist_generator_->generate(input.words());
+      indices = shortlist.words();
+    } else {
+      std::vector<Shortlist> shortlists = shortlist_generator_->generate(
+          input.words(), input.lengths(), group_size);
+      for (const Shortlist &shortlist : shortlists) {
+        groups.push_back(shortlist.words());
+      }
+    }
   }
   // The following can be used to check if shortlist is going wrong.
   // std::vector<uint32_t> indices(vocabulary_.size());
   // std::iota(indices.begin(), indices.end(), 0);
 
   std::vector<bool> complete(batch_size, false);
-  uint32_t eos = vocabulary_.eos_id();
+  uint32_t eos = vocabulary_->eos_id();
   auto record = [eos, &complete](Words &step, Sentences &sentences) {
     size_t finished = 0;
     for (size_t i = 0; i < step.size(); i++) {
@@ -141,32 +221,46 @@ Histories Model::decode(const Tensor &encoder_out, const Input &input) const {
   Alignments alignments(sentences.size());
 
   const Decoder &decoder = transformer_.decoder();
-  Words previous_slice = {};
   std::vector<Tensor> states = decoder.start_states(batch_size);
-  auto [logits, attn] =
-      decoder.step(encoder_out, input.mask(), states, previous_slice, indices);
-
-  if (indices) {
-    previous_slice =
-        greedy_sample_from_words(logits, vocabulary_, *indices, batch_size);
-  } else {
-    previous_slice = greedy_sample(logits, vocabulary_, batch_size);
-  }
 
-  update_alignment(input.lengths(), complete, attn, alignments);
-  record(previous_slice, sentences);
+  // Runs a decoder step and greedily samples the next word of each sentence.
+  auto step = [&](Words &previous_slice) {
+    Metrics::Scope scope(Stage::kDecodeStep);
+    Span span("decode_step");
+    if (!groups.empty()) {
+      auto [logits, attn] = decoder.step(encoder_out, input.mask(), states,
+                                         previous_slice, groups, group_size);
+      previous_slice.clear();
+      for (size_t g = 0; g < groups.size(); g++) {
+        size_t rows = std::min(group_size, batch_size - g * group_size);
+        Words sampled =
+            greedy_sample_from_words(logits[g], *vocabulary_, groups[g], rows);
+        previous_slice.insert(previous_slice.end(), sampled.begin(),
+                              sampled.end());
+      }
+      return std::move(attn);
+    }
 
-  size_t remaining = sentences.size();
-  size_t max_seq_length = input.limit_factor() * source_sequence_length;
-  for (size_t i = 1; i < max_seq_length && remaining > 0; i++) {
     auto [logits, attn] = decoder.step(encoder_out, input.mask(), states,
                                        previous_slice, indices);
     if (indices) {
       previous_slice =
-          greedy_sample_from_words(logits, vocabulary_, *indices, batch_size);
+          greedy_sample_from_words(logits, *vocabulary_, *indices, batch_size);
     } else {
-      previous_slice = greedy_sample(logits, vocabulary_, batch_size);
+      previous_slice = greedy_sample(logits, *vocabulary_, batch_size);
     }
+    return std::move(attn);
+  };
+
+  Words previous_slice = {};
+  Tensor attn = step(previous_slice);
+  update_alignment(input.lengths(), complete, attn, alignments);
+  record(previous_slice, sentences);
+
+  size_t remaining = sentences.size();
+  size_t max_seq_length = input.limit_factor() * source_sequence_length;
+  for (size_t i = 1; i < max_seq_length && remaining > 0; i++) {
+    Tensor attn = step(previous_slice);
     update_alignment(input.lengths(), complete, attn, alignments);
     remaining = record(previous_slice, sentences);
   }
@@ -185,6 +279,14 @@ Histories Model::decode(const Tensor &encoder_out, const Input &input) const {
 }
 
 Histories Model::forward(const Input &input) const {
+  Tensor encoder_out = encode(input);
+  Histories histories = decode(encoder_out, input);
+  return histories;
+}
+
+Tensor Model::encode(const Input &input) const {
+  Metrics::Scope scope(Stage::kEncode);
+  Span span("encode");
   const Tensor &indices = input.indices();
   const Tensor &mask = input.mask();
 
@@ -199,8 +301,202 @@ Histories Model::forward(const Input &input) const {
   // https://github.com/browsermt/marian-dev/blob/14c9d9b0e732f42674e41ee138571d5a7bf7ad94/src/models/transformer.h#L570
   // https://github.com/browsermt/marian-dev/blob/14c9d9b0e732f42674e41ee138571d5a7bf7ad94/src/models/transformer.h#L133
   Tensor encoder_out = transformer_.encoder().forward(word_embedding, mask);
-  Histories histories = decode(encoder_out, input);
-  return histories;
+  return encoder_out;
+}
+
+namespace {
+
+// As Input::finalize() masks padding.
+constexpr float kMasked = -99999999.0F;
+
+// Rows of x listed in rows, in order. If length is non-zero, x is a sequence
+// along its second dimension, each row of which is trimmed or padded with
+// fill to length.
+Tensor select(const Tensor &x, const std::vector<size_t> &rows, size_t length,
+              float fill) {
+  size_t from_length = length ? x.dim(1) : 1;
+  size_t to_length = length ? length : 1;
+  size_t width = x.size() / (x.dim(0) * from_length);
+
+  Shape shape = x.shape();
+  shape.set_dim(0, static_cast<int>(rows.size()));
+  if (length) {
+    shape.set_dim(1, static_cast<int>(length));
+  }
+
+  Tensor selected(x.type(), std::move(shape), x.name());
+  const auto *from = x.data<float>();
+  auto *to = selected.data<float>();
+  size_t copied = std::min(from_length, to_length) * width;
+  for (size_t row : rows) {
+    std::copy(from + row * from_length * width,
+              from + row * from_length * width + copied, to);
+    std::fill(to + copied, to + to_length * width, fill);
+    to += to_length * width;
+  }
+  return selected;
+}
+
+std::vector<size_t> all(size_t rows) {
+  std::vector<size_t> indices(rows);
+  std::iota(indices.begin(), indices.end(), 0);
+  return indices;
+}
+
+// Rows of a followed by rows of b, which agree in every other dimension.
+Tensor concat(const Tensor &a, const Tensor &b) {
+  Shape shape = a.shape();
+  shape.set_dim(0, static_cast<int>(a.dim(0) + b.dim(0)));
+  Tensor concatenated(a.type(), std::move(shape), a.name());
+  auto *out = std::copy(a.begin<float>(), a.end<float>(),
+                        concatenated.begin<float>());
+  std::copy(b.begin<float>(), b.end<float>(), out);
+  return concatenated;
+}
+
+}  // namespace
+
+Model::Live::Live(const Model &model) : model_(model) {
+  if (model.config().shortlist_group_size != 0) {
+    static std::once_flag warned;
+    std::call_once(warned, []() {
+      std::cerr << "[warn] shortlist_group_size does not apply to continuous ";
+      std::cerr << "decoding, which keeps one shortlist across the batch.\n";
+    });
+  }
+}
+
+size_t Model::Live::join(const Input &input) {
+  Tensor encoder_out = model_.encode(input);
+  size_t rows = encoder_out.dim(-3);
+  size_t length = encoder_out.dim(-2);
+  const Decoder &decoder = model_.transformer_.decoder();
+  std::vector<Tensor> states = decoder.start_states(rows);
+
+  // Sequences pad to the longest, live or joining.
+  size_t merged = std::max(length_, length);
+  auto merge = [this, rows](Tensor &live, const Tensor &joining,
+                            size_t length, float fill) {
+    Tensor padded = select(joining, all(rows), length, fill);
+    live = empty() ? std::move(padded)
+                   : concat(select(live, all(size()), length, fill), padded);
+  };
+
+  merge(encoder_out_, encoder_out, merged, 0.0F);
+  merge(mask_, input.mask(), merged, kMasked);
+  states_.resize(states.size());
+  for (size_t i = 0; i < states.size(); i++) {
+    merge(states_[i], states[i], 0, 0.0F);
+  }
+  length_ = merged;
+
+  // Limits follow from the batch a sentence arrived in, as in forward().
+  auto limit = static_cast<size_t>(input.limit_factor() * length);
+  const std::vector<size_t> &lengths = input.lengths();
+  auto source = input.words().begin();
+  size_t first = next_tag_;
+  for (size_t i = 0; i < rows; i++) {
+    tags_.push_back(next_tag_++);
+    sources_.emplace_back(source, source + lengths[i]);
+    source += lengths[i];
+    lengths_.push_back(lengths[i]);
+    limits_.push_back(limit);
+    previous_.push_back(Decoder::kStart);
+    sentences_.emplace_back();
+    alignments_.emplace_back();
+  }
+
+  // Covers newcomers' words. Sentences leaving keep it, as a superset.
+  shortlist_.reset();
+  return first;
+}
+
+std::vector<std::pair<size_t, History>> Model::Live::step() {
+  const Vocabulary &vocabulary = *model_.vocabulary_;
+  const Decoder &decoder = model_.transformer_.decoder();
+  const auto &generator = model_.shortlist_generator_;
+  if (generator && !shortlist_) {
+    Metrics::Scope scope(Stage::kShortlist);
+    Words words;
+    for (const Words &source : sources_) {
+      words.insert(words.end(), source.begin(), source.end());
+    }
+    shortlist_ = generator->generate(words).words();
+  }
+
+  Metrics::Scope scope(Stage::kDecodeStep);
+  Span span("decode_step");
+  span.arg("rows", size());
+  size_t rows = size();
+  auto [logits, attn] =
+      decoder.step(encoder_out_, mask_, states_, previous_, shortlist_);
+  previous_ = shortlist_ ? greedy_sample_from_words(logits, vocabulary,
+                                                    *shortlist_, rows)
+                         : greedy_sample(logits, vocabulary, rows);
+
+  std::vector<bool> finished(rows, false);
+  update_alignment(lengths_, finished, attn, alignments_);
+
+  std::vector<std::pair<size_t, History>> completed;
+  std::vector<size_t> keep;
+  uint32_t eos = vocabulary.eos_id();
+  for (size_t i = 0; i < rows; i++) {
+    sentences_[i].push_back(previous_[i]);
+    if (previous_[i] == eos || sentences_[i].size() >= limits_[i]) {
+      Hypothesis hypothesis{
+          .target = std::move(sentences_[i]),     //
+          .alignment = std::move(alignments_[i])  //
+      };
+      auto history = std::make_shared<Hypothesis>(std::move(hypothesis));
+      completed.emplace_back(tags_[i], std::move(history));
+    } else {
+      keep.push_back(i);
+    }
+  }
+
+  if (keep.size() < rows) {
+    retain(keep);
+  }
+  return completed;
+}
+
+void Model::Live::retain(const std::vector<size_t> &keep) {
+  auto filter = [&keep](auto &values) {
+    // keep is ascending, so keep[i] >= i and moves never clobber a row yet
+    // to be moved. Rows staying put are skipped, as moving onto itself may
+    // leave a value empty.
+    for (size_t i = 0; i < keep.size(); i++) {
+      if (keep[i] != i) {
+        values[i] = std::move(values[keep[i]]);
+      }
+    }
+    values.resize(keep.size());
+  };
+
+  filter(tags_);
+  filter(sources_);
+  filter(lengths_);
+  filter(limits_);
+  filter(previous_);
+  filter(sentences_);
+  filter(alignments_);
+
+  if (keep.empty()) {
+    encoder_out_ = Tensor();
+    mask_ = Tensor();
+    states_.clear();
+    length_ = 0;
+    return;
+  }
+
+  // Padding no longer needed by any row is trimmed along with the rows.
+  size_t length = *std::max_element(lengths_.begin(), lengths_.end());
+  encoder_out_ = select(encoder_out_, keep, length, 0.0F);
+  mask_ = select(mask_, keep, length, kMasked);
+  for (Tensor &state : states_) {
+    state = select(state, keep, 0, 0.0F);
+  }
+  length_ = length;
 }
 
 namespace preset {
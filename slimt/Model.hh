@@ -1,15 +1,19 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "slimt/Annotation.hh"
 #include "slimt/Export.hh"
 #include "slimt/Io.hh"
 #include "slimt/Shortlist.hh"
+#include "slimt/Tensor.hh"
 #include "slimt/TextProcessor.hh"
 #include "slimt/Transformer.hh"
 #include "slimt/Types.hh"
@@ -18,7 +22,6 @@
 namespace slimt {
 
 class Input;
-class Tensor;
 
 template <class Field>
 struct Package {
@@ -37,6 +40,8 @@ class SLIMT_EXPORT Model {
     size_t feed_forward_depth = 2;
     size_t num_heads = 8;
     std::string split_mode = "sentence";
+    std::string shared_weights;
+    size_t shortlist_group_size = 0;
     template <class App>
     void setup_onto(App &app) {
       // clang-format off
@@ -45,6 +50,8 @@ class SLIMT_EXPORT Model {
       app.add_option("--num-heads", num_heads, "Number of decoder layers");
       app.add_option("--ffn-depth", decoder_layers, "Number of feedforward layers");
       app.add_option("--split-mode", split_mode, "Split mode to go with for sentence-splitter.");
+      app.add_option("--shared-weights", shared_weights, "File (e.g. under /dev/shm) to share prepared weights across processes through.");
+      app.add_option("--shortlist-group-size", shortlist_group_size, "Sentences sharing a shortlist, 0 for one shortlist across the batch. Not applied with --continuous.");
       // clang-format on
     }
     // NOLINTEND
@@ -55,16 +62,99 @@ class SLIMT_EXPORT Model {
 
   Histories forward(const Input &input) const;
 
+  /// Encoder output for input, batch x source length x embedding.
+  Tensor encode(const Input &input) const;
+
+  /// Sentences decoding together a step at a time, for iteration-level
+  /// (continuous) batching. Sentences can join between any two steps, their
+  /// encoder output, mask and decoder states merged with those decoding, and
+  /// leave as soon as they complete, rather than wait on the longest.
+  ///
+  /// Sentences are independent of each other in the decoder, so decode as
+  /// they would in a batch of their own, short of the shortlist, which spans
+  /// all sentences since the last join. Config::shortlist_group_size does not
+  /// apply, as groups would have to follow sentences joining and leaving; a
+  /// Model configured with it warns once.
+  class SLIMT_EXPORT Live {
+   public:
+    explicit Live(const Model &model);
+
+    /// Encodes input and adds its sentences to those decoding.
+    /// @returns tag of the first sentence, with the rest following in order.
+    size_t join(const Input &input);
+
+    /// Decodes one more word for every sentence.
+    /// @returns tags and Histories of sentences that completed, which leave.
+    std::vector<std::pair<size_t, History>> step();
+
+    size_t size() const { return tags_.size(); }
+    bool empty() const { return tags_.empty(); }
+
+    /// Padded source tokens held, comparable to a Batch's.
+    size_t tokens() const { return size() * length_; }
+
+   private:
+    /// Keeps only the sentences at rows keep, in ascending order.
+    void retain(const std::vector<size_t> &keep);
+
+    const Model &model_;
+
+    // rows x length_ (x embedding), and decoder states of each row.
+    Tensor encoder_out_;
+    Tensor mask_;
+    std::vector<Tensor> states_;
+    size_t length_ = 0;
+
+    // Per row.
+    std::vector<size_t> tags_;
+    std::vector<Words> sources_;
+    std::vector<size_t> lengths_;
+    std::vector<size_t> limits_;
+    Words previous_;
+    Sentences sentences_;
+    Alignments alignments_;
+
+    std::optional<Words> shortlist_;
+    size_t next_tag_ = 0;
+  };
+
   const Config &config() const { return config_; }
-  const Vocabulary &vocabulary() const { return vocabulary_; }
+  const Vocabulary &vocabulary() const { return *vocabulary_; }
   const TextProcessor &processor() const { return processor_; }
   const Transformer &transformer() const { return transformer_; }
   size_t id() const { return id_; }  // NOLINT
+
+  /// Identity of the files loaded, unlike id() stable across processes, so
+  /// that translations kept on disk are found by later runs. Hashes every
+  /// byte, so that a file changed in place never finds translations of the
+  /// one it replaced. Computed on first call rather than at load, so that
+  /// only Models serving a cache or store pay for it.
+  uint64_t fingerprint() const;
+
+  /// Whether other loaded the same vocabulary, so that words of one are
+  /// words of the other.
+  bool shares_vocabulary(const Model &other) const;
+
+  /// Approximate resident bytes: blobs in Package and weights prepared from
+  /// them at load.
+  size_t footprint() const;
+
+  /// A Model preparing weights of its own on the calling thread, so that
+  /// first-touch places them on the NUMA node that thread runs on. Blobs,
+  /// weights used from them as they are, the vocabulary and the fingerprint
+  /// stay shared with model, rather than parsed or digested again. The
+  /// replica keeps files model mapped alive, but not model itself, which may
+  /// be released first. Blobs model was given as views have to outlive the
+  /// replica too. Replicas never attach to shared weights.
+  static Ptr<Model> replicate(const Ptr<Model> &model);
   const std::optional<ShortlistGenerator> &shortlist_generator() const {
     return shortlist_generator_;
   }
 
  private:
+  /// Replica of origin, see replicate().
+  Model(const Config &config, const Model &origin);
+
   Histories decode(const Tensor &encoder_out, const Input &input) const;
 
   static std::optional<ShortlistGenerator> make_shortlist_generator(
@@ -73,10 +163,20 @@ class SLIMT_EXPORT Model {
   size_t id_;
   Config config_;
   using Mmap = Package<io::MmapFile>;
-  std::optional<Mmap> mmap_;
+  // Files mapped, shared with replicas. Null for a Model given views.
+  Ptr<const Mmap> mmap_;
   Package<View> view_;
 
-  Vocabulary vocabulary_;
+  // Digested on first use, by whichever of a Model and its replicas asks.
+  struct Fingerprint {
+    std::once_flag once;
+    uint64_t value = 0;
+  };
+  Ptr<Fingerprint> fingerprint_;
+
+  // Shared with replicas, as TextProcessor and ShortlistGenerator hold on to
+  // it by reference.
+  Ptr<const Vocabulary> vocabulary_;
   TextProcessor processor_;
   Transformer transformer_;
   std::optional<ShortlistGenerator> shortlist_generator_;
@@ -12,6 +12,7 @@
 #include "slimt/QMM.hh"
 #include "slimt/Tensor.hh"
 #include "slimt/TensorOps.hh"
+#include "slimt/Trace.hh"
 
 namespace slimt {
 
@@ -142,8 +143,23 @@ Tensor join_heads(const Tensor &x) {
   return y;
 }
 
+namespace {
+
+// Span of a multiply of x, named as its output, with the rows and inner
+// dimension of x. Columns show through the name.
+void annotate(Span &span, const Tensor &x) {
+  if (span) {
+    span.arg("rows", x.size() / x.dim(-1));
+    span.arg("depth", x.dim(-1));
+  }
+}
+
+}  // namespace
+
 Tensor affine(const Affine &parameters, const Tensor &x,
               const std::string &name /* = ""*/) {
+  Span span(name, "qmm");
+  annotate(span, x);
   Tensor y = qmm::affine(                              //
       x,                                               //
       parameters.W, parameters.b,                      //
@@ -157,6 +173,9 @@ Tensor affine(const Affine &parameters, const Tensor &x,
 Tensor affine_with_select(const Affine &parameters, const Tensor &x,
                           const std::vector<uint32_t> &indices,
                           const std::string &name /*= ""*/) {
+  Span span(name, "qmm");
+  annotate(span, x);
+  span.arg("selected", indices.size());
   Tensor y = qmm::affine_with_select(                  //
       x,                                               //
       parameters.W, parameters.b,                      //
@@ -170,6 +189,8 @@ Tensor affine_with_select(const Affine &parameters, const Tensor &x,
 
 Tensor linear(const Linear &parameters, const Tensor &x,
               const std::string &name = "") {
+  Span span(name, "qmm");
+  annotate(span, x);
   Tensor y = qmm::dot(                                 //
       x, parameters.W,                                 //
       parameters.quant.item<float>(),                  //
@@ -74,4 +74,10 @@ void prepare_weight_quantized_transposed(const int8_t* input, int8_t* output,
   prepare_weight_quantized_transposed<kProvider>(input, output, rows, cols);
 }
 
+std::string backend() {
+  using detail::backend;
+  using detail::kProvider;
+  return backend<kProvider>();
+}
+
 }  // namespace slimt::qmm
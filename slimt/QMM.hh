@@ -43,6 +43,9 @@ template <enum Provider>
 void prepare_weight_quantized_transposed(const int8_t* input, int8_t* output,
                                          size_t rows, size_t cols);
 
+template <enum Provider>
+std::string backend();
+
 }  // namespace detail
 
 Tensor affine(const Tensor& x, const Tensor& W, const Tensor& b, float a_quant,
@@ -62,4 +65,8 @@ void prepare_weight_transposed(const float* weights, int8_t* prepared,
 void prepare_weight_quantized_transposed(const int8_t* input, int8_t* output,
                                          size_t rows, size_t cols);
 
+/// Names the provider and the instruction set it dispatches to on this CPU,
+/// which together decide the layout of prepared weights.
+std::string backend();
+
 }  // namespace slimt::qmm
@@ -19,10 +19,22 @@ Regex::Regex(const std::string& pattern, uint32_t options, uint32_t jit_options)
                         &error_offset_,        /* for error offset */
                         nullptr))              /* use default compile context */
 {
+  if (re_ != nullptr) {
+    int error_number;
+    PCRE2_SIZE error_offset;
+    anchored_ = pcre2_compile(PCRE2_SPTR(pattern.c_str()),  //
+                              PCRE2_ZERO_TERMINATED,         //
+                              options | PCRE2_ANCHORED,      //
+                              &error_number, &error_offset, nullptr);
+  }
+
   uint32_t have_jit;
   pcre2_config(PCRE2_CONFIG_JIT, &have_jit);
-  if (have_jit) {
+  if (have_jit && re_ != nullptr) {
     pcre2_jit_compile(re_, jit_options);
+    if (anchored_ != nullptr) {
+      pcre2_jit_compile(anchored_, jit_options);
+    }
   }
 
   pattern_ = pattern;
@@ -60,13 +72,27 @@ int Regex::find(
     uint32_t options        // search options
 ) const {
   assert(start <= subj.size());
-  int rc = pcre2_match(re_,                     /* the compiled pattern */
+  const pcre2_code* re = re_;
+  if ((options & PCRE2_ANCHORED) && anchored_ != nullptr) {
+    re = anchored_;
+    options &= ~PCRE2_ANCHORED;
+  }
+
+  auto pcre2_match_with = [&](uint32_t flags) {
+    return pcre2_match(re,                      /* the compiled pattern */
                        PCRE2_SPTR(subj.data()), /* the subject string */
                        subj.size(),             /* the length of the subject */
                        start,                   /* where to start */
-                       options,                 /* options */
+                       flags,                   /* options */
                        match->match_data, /* block for storing the result */
-                       nullptr);          /* use default match context */
+                       match->context);   /* per-thread jit stack */
+  };
+
+  int rc = pcre2_match_with(options);
+  if (rc == PCRE2_ERROR_JIT_STACKLIMIT) {
+    // The interpreter keeps its backtracking on the heap, without the limit.
+    rc = pcre2_match_with(options | PCRE2_NO_JIT);
+  }
   match->data = rc > 0 ? subj.data() : nullptr;
   match->num_matched_groups = rc;
   return rc;  // returns the number of matched groups
@@ -74,14 +100,25 @@ int Regex::find(
 
 bool Regex::ok() const { return re_ != nullptr; }
 
-Regex::~Regex() { pcre2_code_free(re_); }
+Regex::~Regex() {
+  pcre2_code_free(anchored_);
+  pcre2_code_free(re_);
+}
 
 Match::Match(const Regex& re) : Match(re.get_pcre2_code()) {}
 
 Match::Match(const pcre2_code* re)
-    : match_data(pcre2_match_data_create_from_pattern(re, nullptr)) {}
+    : match_data(pcre2_match_data_create_from_pattern(re, nullptr)),
+      jit_stack(pcre2_jit_stack_create(kJitStackStart, kJitStackMax, nullptr)),
+      context(pcre2_match_context_create(nullptr)) {
+  pcre2_jit_stack_assign(context, nullptr, jit_stack);
+}
 
-Match::~Match() { pcre2_match_data_free(match_data); }
+Match::~Match() {
+  pcre2_match_context_free(context);
+  pcre2_jit_stack_free(jit_stack);
+  pcre2_match_data_free(match_data);
+}
 
 std::string_view Match::operator[](int i) const {
   PCRE2_SIZE* o = pcre2_get_ovector_pointer(match_data);
@@ -46,6 +46,10 @@ class Regex {
   PCRE2_SIZE error_offset_;
   int error_number_;
   pcre2_code* const re_;
+
+  // PCRE2 bypasses JIT when PCRE2_ANCHORED is passed at match time, so
+  // anchored matches go through a copy compiled anchored instead.
+  pcre2_code* anchored_{nullptr};
 };
 
 class Match {
@@ -57,6 +61,17 @@ class Match {
   explicit Match(const pcre2_code* re);
   explicit Match(const Regex& re);
   ~Match();
+
+  Match(const Match&) = delete;
+  Match& operator=(const Match&) = delete;
+
+  // A Match is meant to be kept per thread (thread_local static), so the JIT
+  // stack and context matching uses are kept with it. The stack grows up from
+  // PCRE2's 32K default, which long documents can run out of.
+  static constexpr size_t kJitStackStart = 32 * 1024;
+  static constexpr size_t kJitStackMax = 1024 * 1024;
+  pcre2_jit_stack* const jit_stack;
+  pcre2_match_context* const context;
 };
 
 }  // namespace slimt
@@ -0,0 +1,144 @@
+#include "slimt/Registry.hh"
+
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "slimt/Model.hh"
+#include "slimt/Types.hh"
+
+namespace slimt {
+
+namespace {
+
+// Identifies a file by where it lives on disk and when it was last modified,
+// rather than the path, so that symlinks or differently spelt paths to the
+// same file resolve to the same entry, and a file replaced on disk does not.
+std::string identity(const std::string &path) {
+  if (path.empty()) {
+    return "-";
+  }
+
+  struct stat st;
+  if (stat(path.c_str(), &st) == -1) {
+    throw std::runtime_error("Failed to stat file: " + path);
+  }
+
+  std::string id;
+  id += std::to_string(st.st_dev) + ":";
+  id += std::to_string(st.st_ino) + ":";
+  id += std::to_string(st.st_size) + ":";
+
+  // struct stat spells the nanosecond mtime differently across platforms.
+  auto modified = std::filesystem::last_write_time(path);
+  id += std::to_string(modified.time_since_epoch().count());
+  return id;
+}
+
+std::string make_key(const Model::Config &config,
+                     const Package<std::string> &package) {
+  std::string key;
+  key += identity(package.model) + "|";
+  key += identity(package.vocabulary) + "|";
+  key += identity(package.shortlist) + "|";
+  key += identity(package.ssplit) + "|";
+
+  // Config decides how weights are interpreted, so two configs on the same
+  // files are distinct Models.
+  key += std::to_string(config.encoder_layers) + ",";
+  key += std::to_string(config.decoder_layers) + ",";
+  key += std::to_string(config.feed_forward_depth) + ",";
+  key += std::to_string(config.num_heads) + ",";
+  key += config.split_mode + ",";
+  key += std::to_string(config.shortlist_group_size) + ",";
+
+  // Models publishing to or attaching from different files share nothing.
+  key += config.shared_weights;
+  return key;
+}
+
+}  // namespace
+
+ModelRegistry::ModelRegistry(size_t budget) : budget_(budget) {}
+
+Ptr<Model> ModelRegistry::acquire(const Model::Config &config,
+                                  const Package<std::string> &package) {
+  std::string key = make_key(config, package);
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto query = entries_.find(key);
+    if (query != entries_.end()) {
+      Entry &entry = query->second;
+      lru_.splice(lru_.begin(), lru_, entry.position);
+      return entry.model;
+    }
+  }
+
+  // Loading is expensive, so happens outside the lock. If another thread
+  // raced us into loading the same Model, we discard ours and use theirs.
+  auto model = std::make_shared<Model>(config, package);
+  size_t footprint = model->footprint();
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto query = entries_.find(key);
+  if (query != entries_.end()) {
+    Entry &entry = query->second;
+    lru_.splice(lru_.begin(), lru_, entry.position);
+    return entry.model;
+  }
+
+  lru_.push_front(key);
+  Entry entry{
+      .model = model,           //
+      .footprint = footprint,   //
+      .position = lru_.begin()  //
+  };
+  entries_.emplace(std::move(key), std::move(entry));
+  resident_ += footprint;
+
+  evict();
+  return model;
+}
+
+size_t ModelRegistry::collect() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return evict();
+}
+
+size_t ModelRegistry::evict() {
+  size_t evicted = 0;
+  auto position = lru_.end();
+  while (budget_ != 0 && resident_ > budget_ && position != lru_.begin()) {
+    --position;
+    auto query = entries_.find(*position);
+    Entry &entry = query->second;
+
+    // The registry holds the only reference. Since new references are only
+    // handed out under the lock we hold, the Model stays idle until erased.
+    if (entry.model.use_count() == 1) {
+      resident_ -= entry.footprint;
+      entries_.erase(query);
+      position = lru_.erase(position);
+      ++evicted;
+    }
+  }
+  return evicted;
+}
+
+size_t ModelRegistry::resident() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return resident_;
+}
+
+size_t ModelRegistry::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return entries_.size();
+}
+
+}  // namespace slimt
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "slimt/Export.hh"
+#include "slimt/Model.hh"
+#include "slimt/Types.hh"
+
+namespace slimt {
+
+/// ModelRegistry holds Models process-wide, so that Models constructed from
+/// the same files are loaded (and their weights prepared) only once.
+///
+/// Entries are keyed on file identity (device, inode, size and modification
+/// time of each file in the Package) along with the Model::Config, and
+/// acquiring an existing entry returns the same shared Model.
+///
+/// A memory budget bounds the total resident footprint. When over budget,
+/// least-recently-used Models are evicted, but only once they are idle. A
+/// Model is idle when the registry holds the only reference to it. Batches
+/// in-flight in Async hold Ptr<Model> until they are translated, so a Model
+/// in use is never evicted underneath a worker, and is instead collected at
+/// a later acquire() or collect().
+class SLIMT_EXPORT ModelRegistry {
+ public:
+  /// @param [in] budget: Bytes of resident Models to aim for. 0 is unbounded.
+  explicit ModelRegistry(size_t budget = 0);
+
+  /// Obtain a Model for package, loading it if not already resident.
+  Ptr<Model> acquire(const Model::Config &config,
+                     const Package<std::string> &package);
+
+  /// Evict idle Models, least-recently-used first, until under budget.
+  /// @returns number of Models evicted.
+  size_t collect();
+
+  /// Bytes held by resident Models.
+  size_t resident() const;
+
+  /// Number of resident Models.
+  size_t size() const;
+
+ private:
+  struct Entry {
+    Ptr<Model> model;
+    size_t footprint;
+    std::list<std::string>::iterator position;
+  };
+
+  size_t evict();
+
+  size_t budget_;
+  size_t resident_ = 0;
+
+  // Most-recently-used at front.
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, Entry> entries_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace slimt
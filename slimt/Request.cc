@@ -1,5 +1,6 @@
 #include "slimt/Request.hh"
 
+#include <chrono>
 #include <cstddef>
 #include <optional>
 #include <string>
@@ -10,6 +11,7 @@
 #include "slimt/Annotation.hh"
 #include "slimt/Cache.hh"
 #include "slimt/Macros.hh"
+#include "slimt/Metrics.hh"
 #include "slimt/Response.hh"
 #include "slimt/Types.hh"
 #include "slimt/Utils.hh"
@@ -17,7 +19,9 @@
 
 namespace slimt {
 
-size_t cache_key(size_t model_id, const Words &words) {
+namespace {
+
+size_t cache_hash(size_t model_id, const Words &words) {
   auto seed = model_id;
   for (size_t word : words) {
     hash_combine<size_t>(seed, word);
@@ -25,20 +29,46 @@ size_t cache_key(size_t model_id, const Words &words) {
   return seed;
 }
 
+}  // namespace
+
+size_t CacheKeyHash::operator()(const CacheKey &key) const {
+  return cache_hash(key.model, key.words);
+}
+
+size_t CacheKeyHash::operator()(const CacheQuery &query) const {
+  return cache_hash(query.model, query.words);
+}
+
 // -----------------------------------------------------------------
 Request::Request(size_t id, size_t model_id, AnnotatedText &&source,
                  Segments &&segments, const Vocabulary &vocabulary,
                  std::optional<TranslationCache> &cache,
-                 Continuation &&continuation)
+                 TranslationStore *store, Continuation &&continuation,
+                 const Options &options)
     : id_(id),
+      priority_(options.priority),
       model_id_(model_id),
       source_(std::move(source)),
       segments_(std::move(segments)),
       vocabulary_(vocabulary),
       cache_(cache),
-      continuation_(std::move(continuation)) {
+      store_(store),
+      continuation_(std::move(continuation)),
+      partial_(options.partial) {
+  // Requests without a deadline are still given one, so that bulk work ages
+  // to the front of the line instead of starving behind newer arrivals.
+  size_t deadline = options.deadline != 0 ? options.deadline
+                                          : Options::kSlack / (1 + priority_);
+  deadline_ =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(deadline);
+
   counter_ = segments_.size();
+  if (partial_) {
+    done_.resize(segments_.size(), false);
+  }
   histories_.resize(segments_.size(), nullptr);
+  targets_.resize(segments_.size());
+  target_views_.resize(segments_.size());
 
   // 1. If there are no segments_, we are never able to trigger the
   // response_builder calls from a different thread. This happens when the use
@@ -55,17 +85,18 @@ Request::Request(size_t id, size_t model_id, AnnotatedText &&source,
     words_total_ = 0;
     words_complete_ = 0;
 
-    if (cache_) {
+    if (cache_ || store_) {
       // Iterate through segments, see if any can be prefilled from cache. If
       // prefilled, mark the particular segments as complete (non-empty
       // ProcessedSegmentRef). Also update accounting used elsewhere
       // (counter_) to reflect one less segment to translate.
       for (size_t idx = 0; idx < segments_.size(); idx++) {
         words_total_ += segments_[idx].size();
-        size_t key = cache_key(model_id_, segment(idx));
-        auto [found, history] = cache_->find(key);
-        if (found) {
-          histories_[idx] = history;
+        History history = lookup(idx);
+        if (history) {
+          histories_[idx] = std::move(history);
+          decode(idx);
+          emit(idx);
           --counter_;
           words_complete_ += segments_[idx].size();
         }
@@ -86,6 +117,35 @@ Request::Request(size_t id, size_t model_id, AnnotatedText &&source,
 
 size_t Request::size() const { return segments_.size(); }
 
+History Request::lookup(size_t index) {
+  Timer timer;
+  auto hit = [&timer](History history) {
+    Metrics::instance()[Stage::kCacheHit].record(timer.elapsed());
+    return history;
+  };
+
+  CacheQuery query{.model = model_id_, .words = segment(index)};
+  if (cache_) {
+    auto [found, history] = cache_->find(query);
+    if (found) {
+      return hit(std::move(history));
+    }
+  }
+
+  if (store_) {
+    // Promoted into cache_, so repeats do not go to disk again.
+    History history = store_->find(query);
+    if (history) {
+      if (cache_) {
+        CacheKey key{.model = model_id_, .words = segment(index)};
+        cache_->store(key, history);
+      }
+      return hit(std::move(history));
+    }
+  }
+  return nullptr;
+}
+
 bool Request::cached(size_t index) const {
   return histories_[index] != nullptr;
 }
@@ -111,7 +171,7 @@ size_t Request::word_count(size_t index) const {
 
 const Segment &Request::segment(size_t index) const { return segments_[index]; }
 
-void Request::process(size_t index, History history) {
+void Request::process(size_t index, History history, bool follower) {
   // Concurrently called by multiple workers as a history from translation is
   // ready. The container storing histories is set with the value obtained.
 
@@ -119,9 +179,16 @@ void Request::process(size_t index, History history) {
   // this was a cache-miss to have got through, update cache if available to
   // store the result.
   histories_[index] = std::move(history);
-  if (cache_) {
-    size_t key = cache_key(model_id_, segment(index));
-    cache_->store(key, histories_[index]);
+  decode(index);
+  emit(index);
+  if (!follower && (cache_ || store_)) {
+    CacheKey key{.model = model_id_, .words = segment(index)};
+    if (cache_) {
+      cache_->store(key, histories_[index]);
+    }
+    if (store_) {
+      store_->append(key, histories_[index]);
+    }
   }
 
   words_complete_ += segments_[index].size();
@@ -133,6 +200,42 @@ void Request::process(size_t index, History history) {
   }
 }
 
+void Request::decode(size_t index) {
+  Metrics::Scope scope(Stage::kDetokenize);
+  const Words &words = histories_[index]->target;
+  target_views_[index] =
+      vocabulary_.decode(words, targets_[index], /*ignore_eos=*/false);
+}
+
+void Request::emit(size_t index) {
+  if (!partial_) {
+    return;
+  }
+
+  // Holding the lock through partial_ keeps calls one at a time, in order.
+  // Every emit() finishes before its caller decrements counter_, so none is
+  // still reading histories_ when complete() takes them.
+  std::lock_guard<std::mutex> guard(emit_mutex_);
+  done_[index] = true;
+  while (emitted_ < done_.size() && done_[emitted_]) {
+    const Views &views = target_views_[emitted_];
+    std::string target;
+    if (!views.empty()) {
+      target.assign(views.front().data(),
+                    views.back().data() + views.back().size());
+    }
+
+    Partial partial{
+        .index = emitted_,                              //
+        .source = source_.sentence_as_range(emitted_),  //
+        .target = std::move(target),                    //
+        .alignment = histories_[emitted_]->alignment    //
+    };
+    partial_(std::move(partial));
+    ++emitted_;
+  }
+}
+
 void Request::complete(Histories &&histories) {
   SLIMT_ABORT_IF(source_.sentence_count() != histories.size(),
                  "Mismatch in source and translated sentences");
@@ -145,9 +248,7 @@ void Request::complete(Histories &&histories) {
   response.target.text.reserve(response.source.text.size());
 
   for (size_t sentence_id = 0; sentence_id < histories.size(); sentence_id++) {
-    Words words = histories[sentence_id]->target;
-    std::string decoded;
-    auto views = vocabulary_.decode(words, decoded, /*ignore_eos=*/false);
+    Views &views = target_views_[sentence_id];
 
     // For each sentence, prepend the filler text between the corresponding
     // source-sentence and the source-sentence before.
@@ -162,8 +263,16 @@ void Request::complete(Histories &&histories) {
           response.source.gap(sentence_id + 1));
     }
 
-    Alignment &alignment = histories[sentence_id]->alignment;
-    response.alignments.push_back(std::move(alignment));
+    // Histories in the cache are shared with later Requests hitting it, and
+    // must keep their alignments and words.
+    Hypothesis &hypothesis = *histories[sentence_id];
+    if (cache_) {
+      response.alignments.push_back(hypothesis.alignment);
+      response.words.push_back(hypothesis.target);
+    } else {
+      response.alignments.push_back(std::move(hypothesis.alignment));
+      response.words.push_back(std::move(hypothesis.target));
+    }
   }
 
   next_ = continuation_(std::move(response));
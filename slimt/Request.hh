@@ -2,13 +2,18 @@
 
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <vector>
 
 #include "slimt/Annotation.hh"
+#include "slimt/Response.hh"
+#include "slimt/Store.hh"
 #include "slimt/Types.hh"
 #include "slimt/Vocabulary.hh"
 
@@ -35,12 +40,18 @@ namespace slimt {
 class Request {
  public:
   using Continuation = std::function<Ptr<Request>(Response &&response)>;
+  using PartialCallback = std::function<void(Partial &&partial)>;
+
   /// Constructs an internal representation of the Request identified by Id,
   /// processed Segments and accepts a callback (ResponseBuilder) which builds
-  /// the Response upon completion of the Request.
+  /// the Response upon completion of the Request. Segments are looked up in
+  /// cache, then store, before being left to translate. From options,
+  /// priority and deadline place the Request among others, and partial if set
+  /// is called with each sentence, in order, as they complete.
   Request(size_t id, size_t model_id, AnnotatedText &&source,
           Segments &&segments, const Vocabulary &vocabulary,
-          std::optional<TranslationCache> &cache, Continuation &&continuation);
+          std::optional<TranslationCache> &cache, TranslationStore *store,
+          Continuation &&continuation, const Options &options);
 
   /// Obtain the count of tokens in the segment correponding to index. Used to
   /// insert segment from multiple requests into the corresponding size
@@ -55,12 +66,15 @@ class Request {
   const Segment &segment(size_t index) const;
 
   /// For notions of priority among requests, used to enable std::set in
-  /// BatchingPool.
+  /// BatchingPool. Earlier effective deadlines go first, then higher
+  /// priority, then earlier submission (see Options::priority).
   friend bool operator<(const Request &a, const Request &b);
 
   /// Processes a history obtained after translating in a heterogenous batch
-  /// compiled from requests.
-  void process(size_t index, History history);
+  /// compiled from requests. A follower, handed the translation of an
+  /// identical sentence another Request led, leaves storing it in cache and
+  /// store to the leader.
+  void process(size_t index, History history, bool follower = false);
 
   bool cached(size_t index) const;
 
@@ -68,9 +82,23 @@ class Request {
 
   std::pair<Fraction, Fraction> progress() const;
 
+  size_t id() const { return id_; }  // NOLINT
+
  private:
   void complete(Histories &&histories);
 
+  /// Translation of the segment at index from cache_ or store_, or nullptr.
+  History lookup(size_t index);
+
+  /// Decodes the history at index into text, as soon as it is available.
+  /// Called by workers as they process their Batch, so that completing the
+  /// Request only has to assemble already decoded sentences.
+  void decode(size_t index);
+
+  /// Marks the sentence at index translated, and hands partial_ every
+  /// sentence translated from emitted_ onwards without a gap.
+  void emit(size_t index);
+
   /// Multiple translation-workers can concurrently access the same Request.
   /// The following atomic atomically operates on the variable holding
   /// segments remaining to be translated.
@@ -82,7 +110,12 @@ class Request {
 
   size_t id_;
 
-  /// Model associated with this request
+  /// Effective deadline, and priority, from Options.
+  std::chrono::steady_clock::time_point deadline_;
+  size_t priority_;
+
+  /// Fingerprint of the Model associated with this request, keying cached
+  /// translations.
   size_t model_id_;
 
   // Source text.
@@ -97,11 +130,25 @@ class Request {
   /// segment in the corresponding index.
   Histories histories_;
 
+  /// Decoded text of each history, and views of its tokens in that text.
+  std::vector<std::string> targets_;
+  std::vector<Views> target_views_;
+
   /// Cache used to hold segment translations. If nullopt, means no-caching.
   std::optional<TranslationCache> &cache_;
 
+  /// Translations kept on disk, or nullptr.
+  TranslationStore *store_;
+
   Continuation continuation_;
   Ptr<Request> next_ = nullptr;
+
+  /// Sentences are reported in order, so those done ahead of a predecessor
+  /// wait in done_ until emitted_ reaches them.
+  PartialCallback partial_;
+  std::vector<bool> done_;
+  size_t emitted_ = 0;
+  std::mutex emit_mutex_;
 };
 
 }  // namespace slimt
@@ -2,7 +2,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <future>
 #include <utility>
 #include <vector>
 
@@ -148,9 +150,23 @@ std::vector<Alignment> remap_alignments(const Response &first,
     auto source_side_pivots = extract_word_ranges(first.target, sentence_id);
     auto target_side_pivots = extract_word_ranges(second.source, sentence_id);
 
-    // Reintrepret probability p(q'_j' | t_k) as p(q_j | t_k)
-    Alignment remapped_pivot_given_targets = transfer_through_characters(
-        source_side_pivots, target_side_pivots, pivot_given_targets);
+    // Reintrepret probability p(q'_j' | t_k) as p(q_j | t_k). Pivots handed
+    // over as words keep their tokens, and with them the same ranges, so
+    // there is nothing to transfer.
+    auto same = [](const Range &a, const Range &b) {
+      return a.begin == b.begin && a.end == b.end;
+    };
+    bool retokenized = !std::equal(
+        source_side_pivots.begin(), source_side_pivots.end(),
+        target_side_pivots.begin(), target_side_pivots.end(), same);
+
+    Alignment transferred;
+    if (retokenized) {
+      transferred = transfer_through_characters(
+          source_side_pivots, target_side_pivots, pivot_given_targets);
+    }
+    const Alignment &remapped_pivot_given_targets =
+        retokenized ? transferred : pivot_given_targets;
 
     // Marginalize out q_j.
     // p(s_i | t_k) = \sum_{j} p(s_i | q_j) x p(q_j | t_k)
@@ -194,6 +210,21 @@ void Response::to(Encoding encoding) {
 }
 
 Handle::Info Handle::info() {
+  if (!request_ && pending_.wait_for(std::chrono::seconds(0)) ==
+                       std::future_status::ready) {
+    request_ = pending_.get();
+  }
+
+  // Until preprocessing finishes, there is no progress to report on.
+  if (!request_) {
+    return Info{
+        .wps = 0,                                //
+        .parts = Fraction{.p = 1, .q = parts_},  //
+        .words = Fraction{.p = 0, .q = 1},       //
+        .segments = Fraction{.p = 0, .q = 1}     //
+    };
+  }
+
   auto [words, segments] = request_->progress();
   double wps = static_cast<float>(words.p) / timer_.elapsed();
 
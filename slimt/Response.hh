@@ -2,7 +2,10 @@
 
 #include <cassert>
 #include <cstddef>
+#include <functional>
+#include <future>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "slimt/Annotation.hh"
@@ -30,6 +33,11 @@ struct Response {
   /// with an alignment matrix for each sentence.
   std::vector<std::vector<std::vector<float>>> alignments;
 
+  /// Words of each target sentence as decoded, ending in EOS unless decoding
+  /// stopped at the length limit. Pivoting hands these to a second Model
+  /// sharing the vocabulary, instead of tokenizing the target text again.
+  Sentences words;
+
   /// Convenience function to obtain number of units translated. Same as
   /// `.source.sentence_count()` and `.target.sentence_count().` The processing
   /// of a text of into sentences are handled internally, and this information
@@ -40,11 +48,45 @@ struct Response {
   void to(Encoding encoding);
 };
 
+/// A sentence of a Response, made available ahead of the whole Response.
+struct Partial {
+  size_t index;         ///< Position of the sentence in Response::source.
+  Range source;         ///< Bytes of the sentence in the source text.
+  std::string target;   ///< Translated text of the sentence.
+  Alignment alignment;  ///< As Response::alignments, for this sentence.
+};
+
 /// Options dictate how to construct a Response for an input string of
 /// text to be translated.
 struct Options {
   bool alignment{false};  ///< Include alignments or not.
   bool html{false};       ///< Remove HTML tags from text and insert in output.
+
+  /// Milliseconds after submission given to requests without a deadline,
+  /// divided by 1 + priority.
+  static constexpr size_t kSlack = 10000;
+
+  /// Sentences are batched in order of the effective deadline of their
+  /// request, earliest first, then of higher priority, then of earlier
+  /// submission. The effective deadline is deadline after submission if set,
+  /// else kSlack / (1 + priority) milliseconds after submission.
+  ///
+  /// Priority and deadline therefore share one scale: priority 1 alone ranks
+  /// as a deadline of 5000, and a request with neither is overtaken by one
+  /// submitted up to 10 seconds later with either. Work that has waited
+  /// long enough goes ahead of newer work whatever its priority, so none
+  /// starves.
+  size_t priority{0};
+
+  /// Milliseconds after submission to aim to complete within, or 0 for none,
+  /// overriding priority in the effective deadline (see priority).
+  size_t deadline{0};
+
+  /// If set, called with each sentence as soon as it and every sentence
+  /// before it are translated, in order, on the worker thread that completed
+  /// it. The Response still follows as usual. Text is plain, as HTML is only
+  /// restored into the Response. Pivoting reports the Response only.
+  std::function<void(Partial &&)> partial;
 };
 
 std::vector<Alignment> remap_alignments(const Response &first,
@@ -68,6 +110,13 @@ class Handle {
   Handle(const Ptr<Request> &request, size_t parts, Future &&future)
       : request_(request), parts_(parts), future_(std::move(future)) {}
 
+  /// For a Request still being preprocessed, which becomes available later.
+  Handle(std::shared_future<Ptr<Request>> pending, size_t parts,
+         Future &&future)
+      : pending_(std::move(pending)),
+        parts_(parts),
+        future_(std::move(future)) {}
+
   // The following information is picked up and exported via ::info()
   struct Info {
     double wps;
@@ -81,6 +130,7 @@ class Handle {
 
  private:
   Ptr<Request> request_;
+  std::shared_future<Ptr<Request>> pending_;
 
   size_t part_ = 0;
   size_t parts_;
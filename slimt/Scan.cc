@@ -0,0 +1,232 @@
+#include "slimt/Scan.hh"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(USE_AVX2) || defined(USE_SSE2)
+#include <immintrin.h>
+#elif defined(USE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace slimt::scan {
+
+namespace {
+
+// Sentence enders the chunker looks for: ASCII . ? ! and the multi-byte
+// ։ (D6 89), 。 (E3 80 82), ！ (EF BC 81) and ？ (EF BC 9F). next_ender_byte
+// stops at the ASCII enders and the lead bytes of the others.
+bool ender_at(const char* position, const char* end) {
+  auto match = [position, end](std::string_view sequence) {
+    return static_cast<size_t>(end - position) >= sequence.size() &&
+           std::string_view(position, sequence.size()) == sequence;
+  };
+
+  switch (static_cast<unsigned char>(*position)) {
+    case '.':
+    case '?':
+    case '!':
+      return true;
+    case 0xD6:
+      return match("։");
+    case 0xE3:
+      return match("。");
+    case 0xEF:
+      return match("！") || match("？");
+    default:
+      return false;
+  }
+}
+
+bool ender_byte(unsigned char c) {
+  return c == '.' || c == '?' || c == '!' || c == 0xD6 || c == 0xE3 ||
+         c == 0xEF;
+}
+
+}  // namespace
+
+namespace scalar {
+
+const char* next_ender_byte(const char* begin, const char* end) {
+  for (const char* position = begin; position < end; ++position) {
+    if (ender_byte(static_cast<unsigned char>(*position))) {
+      return position;
+    }
+  }
+  return end;
+}
+
+const char* skip_ascii(const char* begin, const char* end) {
+  const char* position = begin;
+  while (position < end && static_cast<unsigned char>(*position) < 0x80) {
+    ++position;
+  }
+  return position;
+}
+
+}  // namespace scalar
+
+const char* next_ender_byte(const char* begin, const char* end) {
+  const char* position = begin;
+#if defined(USE_AVX2)
+  const __m256i period = _mm256_set1_epi8('.');
+  const __m256i question = _mm256_set1_epi8('?');
+  const __m256i exclamation = _mm256_set1_epi8('!');
+  const __m256i armenian = _mm256_set1_epi8(static_cast<char>(0xD6));
+  const __m256i cjk = _mm256_set1_epi8(static_cast<char>(0xE3));
+  const __m256i fullwidth = _mm256_set1_epi8(static_cast<char>(0xEF));
+  for (; end - position >= 32; position += 32) {
+    __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position));
+    __m256i ascii = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, period),
+                        _mm256_cmpeq_epi8(bytes, question)),
+        _mm256_cmpeq_epi8(bytes, exclamation));
+    __m256i lead = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, armenian),
+                        _mm256_cmpeq_epi8(bytes, cjk)),
+        _mm256_cmpeq_epi8(bytes, fullwidth));
+    auto mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_or_si256(ascii, lead)));
+    if (mask != 0) {
+      return position + std::countr_zero(mask);
+    }
+  }
+#elif defined(USE_SSE2)
+  const __m128i period = _mm_set1_epi8('.');
+  const __m128i question = _mm_set1_epi8('?');
+  const __m128i exclamation = _mm_set1_epi8('!');
+  const __m128i armenian = _mm_set1_epi8(static_cast<char>(0xD6));
+  const __m128i cjk = _mm_set1_epi8(static_cast<char>(0xE3));
+  const __m128i fullwidth = _mm_set1_epi8(static_cast<char>(0xEF));
+  for (; end - position >= 16; position += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+    __m128i ascii = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, period),
+                                              _mm_cmpeq_epi8(bytes, question)),
+                                 _mm_cmpeq_epi8(bytes, exclamation));
+    __m128i lead = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, armenian),
+                                             _mm_cmpeq_epi8(bytes, cjk)),
+                                _mm_cmpeq_epi8(bytes, fullwidth));
+    auto mask =
+        static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(ascii, lead)));
+    if (mask != 0) {
+      return position + std::countr_zero(mask);
+    }
+  }
+#elif defined(USE_NEON)
+  const uint8x16_t period = vdupq_n_u8('.');
+  const uint8x16_t question = vdupq_n_u8('?');
+  const uint8x16_t exclamation = vdupq_n_u8('!');
+  const uint8x16_t armenian = vdupq_n_u8(0xD6);
+  const uint8x16_t cjk = vdupq_n_u8(0xE3);
+  const uint8x16_t fullwidth = vdupq_n_u8(0xEF);
+  for (; end - position >= 16; position += 16) {
+    uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(position));
+    uint8x16_t ascii = vorrq_u8(
+        vorrq_u8(vceqq_u8(bytes, period), vceqq_u8(bytes, question)),
+        vceqq_u8(bytes, exclamation));
+    uint8x16_t lead =
+        vorrq_u8(vorrq_u8(vceqq_u8(bytes, armenian), vceqq_u8(bytes, cjk)),
+                 vceqq_u8(bytes, fullwidth));
+    // Narrow to a nibble per byte, NEON having no movemask.
+    uint8x8_t narrowed =
+        vshrn_n_u16(vreinterpretq_u16_u8(vorrq_u8(ascii, lead)), 4);
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+    if (mask != 0) {
+      return position + std::countr_zero(mask) / 4;
+    }
+  }
+#endif
+  return scalar::next_ender_byte(position, end);
+}
+
+const char* next_ender(const char* begin, const char* end) {
+  const char* position = next_ender_byte(begin, end);
+  while (position != end && !ender_at(position, end)) {
+    position = next_ender_byte(position + 1, end);
+  }
+  return position;
+}
+
+const char* skip_ascii(const char* begin, const char* end) {
+  const char* position = begin;
+#if defined(USE_AVX2)
+  for (; end - position >= 32; position += 32) {
+    __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position));
+    auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(bytes));
+    if (mask != 0) {
+      return position + std::countr_zero(mask);
+    }
+  }
+#elif defined(USE_SSE2)
+  for (; end - position >= 16; position += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+    if (mask != 0) {
+      return position + std::countr_zero(mask);
+    }
+  }
+#elif defined(USE_NEON)
+  for (; end - position >= 16; position += 16) {
+    uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(position));
+    // Narrowed as in next_ender_byte, vmaxvq_u8 being AArch64 only.
+    uint8x16_t high = vcgeq_u8(bytes, vdupq_n_u8(0x80));
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(high), 4);
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+    if (mask != 0) {
+      return position + std::countr_zero(mask) / 4;
+    }
+  }
+#endif
+  return scalar::skip_ascii(position, end);
+}
+
+bool valid_utf8(const char* begin, const char* end) {
+  const auto* position = reinterpret_cast<const unsigned char*>(begin);
+  const auto* stop = reinterpret_cast<const unsigned char*>(end);
+  auto continuation = [](unsigned char c) { return (c & 0xC0) == 0x80; };
+
+  while (true) {
+    position = reinterpret_cast<const unsigned char*>(
+        skip_ascii(reinterpret_cast<const char*>(position), end));
+    if (position == stop) {
+      return true;
+    }
+
+    unsigned char lead = *position;
+    size_t left = stop - position;
+
+    // Bounds on the second byte, narrower than 80..BF for some leads.
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    size_t length = 0;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+      length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      length = 3;
+      low = lead == 0xE0 ? 0xA0 : low;
+      high = lead == 0xED ? 0x9F : high;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      length = 4;
+      low = lead == 0xF0 ? 0x90 : low;
+      high = lead == 0xF4 ? 0x8F : high;
+    } else {
+      return false;
+    }
+
+    if (left < length || position[1] < low || position[1] > high) {
+      return false;
+    }
+    for (size_t i = 2; i < length; i++) {
+      if (!continuation(position[i])) {
+        return false;
+      }
+    }
+    position += length;
+  }
+}
+
+}  // namespace slimt::scan
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace slimt::scan {
+
+// Byte scans the splitter runs ahead of PCRE2. Those with a scalar:: twin are
+// vectorized under USE_AVX2, USE_SSE2 or USE_NEON, and must agree with it.
+
+/// What \s matches in patterns compiled without PCRE2_UCP.
+inline bool ascii_whitespace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/// Returns the first byte in [begin, end) that may start a sentence ender, or
+/// end if there is none. Candidates still need checking, as next_ender does.
+const char* next_ender_byte(const char* begin, const char* end);
+
+/// Returns the first sentence ender in [begin, end), or end if none. Enders
+/// are ASCII . ? ! and the multi-byte ։ 。 ！ ？.
+const char* next_ender(const char* begin, const char* end);
+
+/// Returns the end of the leading run of ASCII bytes in [begin, end).
+const char* skip_ascii(const char* begin, const char* end);
+
+/// Whether [begin, end) is well-formed UTF-8: no overlong forms, surrogates or
+/// code points past U+10FFFF.
+bool valid_utf8(const char* begin, const char* end);
+
+namespace scalar {
+
+const char* next_ender_byte(const char* begin, const char* end);
+const char* skip_ascii(const char* begin, const char* end);
+
+}  // namespace scalar
+
+}  // namespace slimt::scan
@@ -1,7 +1,10 @@
 #include "slimt/Shortlist.hh"
 
+#include <algorithm>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
@@ -112,44 +115,81 @@ ShortlistGenerator::ShortlistGenerator(                        //
   (void)source_index_;
 }
 
+namespace {
+
+// Bitset reused across calls on the same thread, and kept all-zero in between.
+// Blocks set during a call are remembered, so that extracting and clearing
+// cost in the number of blocks touched rather than the vocabulary size.
+struct Bitset {
+  static constexpr size_t kBits = 64;
+
+  std::vector<uint64_t> blocks;
+  std::vector<size_t> touched;
+
+  void reserve(size_t bits) {
+    size_t size = (bits + kBits - 1) / kBits;
+    if (blocks.size() < size) {
+      blocks.resize(size, 0);
+    }
+  }
+
+  bool test(size_t i) const { return (blocks[i / kBits] >> (i % kBits)) & 1; }
+
+  void set(size_t i) {
+    uint64_t& block = blocks[i / kBits];
+    if (block == 0) {
+      touched.push_back(i / kBits);
+    }
+    block |= uint64_t{1} << (i % kBits);
+  }
+
+  void clear() {
+    for (size_t b : touched) {
+      blocks[b] = 0;
+    }
+    touched.clear();
+  }
+};
+
+}  // namespace
+
 Shortlist ShortlistGenerator::generate(const Words& words) const {
   size_t source_size = source_.size();
   size_t target_size = target_.size();
 
-  // Since V=target_.size() is not large, anchor the time and space
-  // complexity to O(V). Attempt to squeeze the truth tables into CPU cache
-  std::vector<bool> source_table(source_size, false);
-  std::vector<bool> target_table(target_size, false);
+  // The skip list already holds each source word's contribution to the
+  // target table, so only the tables themselves need to be made cheap.
+  thread_local static Bitset source_table;
+  thread_local static Bitset target_table;
+  source_table.reserve(source_size);
+  target_table.reserve(target_size);
 
   // Add frequent most frequent words
   for (Word i = 0; i < frequent_ && i < target_size; ++i) {
-    target_table[i] = true;
+    target_table.set(i);
   }
 
   // Collect unique words from source.
   // Add aligned target words: mark target_table[word] to 1
   for (auto word : words) {
     if (shared_) {
-      target_table[word] = true;
+      target_table.set(word);
     }
     // If word has not been encountered, add the corresponding target
     // words
-    if (!source_table[word]) {
+    if (!source_table.test(word)) {
       size_t begin = word_to_offset_[word];
       size_t end = word_to_offset_[word + 1];
       for (uint64_t j = begin; j < end; j++) {
-        target_table[shortlist_[j]] = true;
+        target_table.set(shortlist_[j]);
       }
-      source_table[word] = true;
+      source_table.set(word);
     }
   }
 
-  // Due to the 'multiple-of-eight' issue, the following O(N) patch is inserted
   size_t target_table_ones = 0;  // counter for no. of selected target words
-  for (size_t i = 0; i < target_size; i++) {
-    if (target_table[i]) {
-      target_table_ones++;
-    }
+  for (size_t b : target_table.touched) {
+    target_table_ones += std::popcount(target_table.blocks[b]);
   }
 
   // Ensure that the generated vocabulary items from a shortlist are a
@@ -157,21 +197,43 @@ Shortlist ShortlistGenerator::generate(const Words& words) const {
   // non-multiple-of-eight matrices.
   for (size_t i = frequent_;
        i < target_size && target_table_ones % kVExtAlignment != 0; i++) {
-    if (!target_table[i]) {
-      target_table[i] = true;
+    if (!target_table.test(i)) {
+      target_table.set(i);
       target_table_ones++;
     }
   }
 
-  // turn selected indices into vector and sort (Bucket sort: O(V))
+  // Extract set bits block by block, lowest first, for sorted indices.
+  std::sort(target_table.touched.begin(), target_table.touched.end());
   std::vector<Word> indices;
-  for (Word i = 0; i < target_size; i++) {
-    if (target_table[i]) {
-      indices.push_back(i);
+  indices.reserve(target_table_ones);
+  for (size_t b : target_table.touched) {
+    uint64_t block = target_table.blocks[b];
+    while (block != 0) {
+      size_t offset = std::countr_zero(block);
+      indices.push_back(static_cast<Word>(b * Bitset::kBits + offset));
+      block &= block - 1;
     }
   }
 
+  source_table.clear();
+  target_table.clear();
   return Shortlist(std::move(indices));
 }
 
+std::vector<Shortlist> ShortlistGenerator::generate(
+    const Words& words, const std::vector<size_t>& lengths,
+    size_t group_size) const {
+  std::vector<Shortlist> shortlists;
+  auto group_begin = words.begin();
+  for (size_t i = 0; i < lengths.size(); i += group_size) {
+    size_t end = std::min(lengths.size(), i + group_size);
+    size_t count = std::accumulate(lengths.begin() + i, lengths.begin() + end,
+                                   size_t{0});
+    shortlists.push_back(generate(Words(group_begin, group_begin + count)));
+    group_begin += count;
+  }
+  return shortlists;
+}
+
 }  // namespace slimt
@@ -53,6 +53,13 @@ class ShortlistGenerator {
 
   Shortlist generate(const Words& words) const;
 
+  /// Shortlists of consecutive groups of group_size sentences, the last
+  /// possibly smaller, each covering words of its own group only. Sentences
+  /// follow each other in words, lengths[i] words for sentence i.
+  std::vector<Shortlist> generate(const Words& words,
+                                  const std::vector<size_t>& lengths,
+                                  size_t group_size) const;
+
  private:
   const Vocabulary& source_;
   const Vocabulary& target_;
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <ostream>
 #include <sstream>
@@ -10,6 +12,7 @@
 #include <pcre2.h>
 
 #include "slimt/Regex.hh"
+#include "slimt/Scan.hh"
 #include "slimt/Splitter.hh"
 
 namespace slimt {
@@ -31,7 +34,7 @@ void Splitter::load(const std::string& fname) {
 void Splitter::declare_prefix(std::string_view buffer) {
   // parse a line from a prefix file and interpret it
   static Regex pat(R"(([^#\s]*)\s*(?:(#\s*NUMERIC_ONLY\s*#))?)", PCRE2_UTF);
-  Match match(pat);
+  thread_local static Match match(pat);
   if (pat.find(buffer, &match) > 0) {
     auto m1 = match[1];
     if (!m1.empty()) {
@@ -110,11 +113,13 @@ std::string& single_line(
 // 1: prefix
 // 2: prefix only in front of numbers
 int Splitter::get_prefix_class(std::string_view piece) const {
-  static Regex foo(".*\\s([^\\s]*)", PCRE2_DOTALL);
-  static Match match(foo);
-  if (foo.consume(&piece, &match, PCRE2_NO_UTF_CHECK) > 0) {
-    piece = match[1];
+  // Only the last whitespace-delimited token of piece is a candidate prefix.
+  auto last =
+      std::find_if(piece.rbegin(), piece.rend(), scan::ascii_whitespace);
+  if (last != piece.rend()) {
+    piece.remove_prefix(piece.rend() - last);
   }
+
   auto m = prefix_type_.find(piece);
   // for debugging:
   // std::cout << piece << " " << (m == prefix_type_.end() ? 0 : m->second) <<
@@ -180,9 +185,34 @@ std::string_view Splitter::operator()(std::string_view* rest) const {
   whitespace_re.consume(rest, &whitespace_m, PCRE2_NO_UTF_CHECK);
   const char* snt_start = rest->data();
   const char* snt_end = rest->data() + rest->size();
-  while ((success = chunker_re.consume(rest, &chunker_m, PCRE2_NO_UTF_CHECK)) >
-         0) {
-    auto whole_match = chunker_m[0];
+
+  // Advances rest to where the chunker would next match. The chunker lazily
+  // skips everything up to the alphanumeric run before the first ender, so
+  // starting it after the last whitespace before that ender finds the same
+  // match, without having it walk the text in between.
+  auto next_chunk = [rest]() {
+    const char* begin = rest->data();
+    const char* end = begin + rest->size();
+    const char* ender = scan::next_ender(begin, end);
+    if (ender == end) {
+      return 0;
+    }
+
+    const char* start = ender;
+    while (start > begin && !scan::ascii_whitespace(*(start - 1))) {
+      --start;
+    }
+
+    std::string_view from(start, end - start);
+    int success = chunker_re.consume(&from, &chunker_m, PCRE2_NO_UTF_CHECK);
+    if (success > 0) {
+      *rest = from;
+    }
+    return success;
+  };
+
+  const char* chunk_start = rest->data();
+  while ((success = next_chunk()) > 0) {
     auto prefix = chunker_m[1];
     auto punct = chunker_m[2];             // punctuation
     auto tail = chunker_m[3];              // trailing punctuation
@@ -200,6 +230,10 @@ std::string_view Splitter::operator()(std::string_view* rest) const {
     //           << following_symbol << std::endl;
 
     // whitespace not required after ideographic full widths
+    // Text skipped by this chunk started where the last one ended.
+    const char* whole_match = chunk_start;
+    chunk_start = rest->data();
+
     if (whitespace_after.empty() &&
         !(punct == "。" || punct == "！" || punct == "？")) {
       continue;
@@ -230,7 +264,7 @@ std::string_view Splitter::operator()(std::string_view* rest) const {
     } else {
       // check for in-text ellipsis "[...]"
       if (punct == "..." &&
-          (punct.data() - whole_match.data() > 1)  // not at the beginning
+          (punct.data() - whole_match > 1)  // not at the beginning
           && tail == "]" && *(punct.data() - 1) == '[') {
         continue;
       }
@@ -271,7 +305,8 @@ std::string_view read_line(const char** start, const char* const stop) {
     return line;
   }
   const char* c = *start;
-  while (c < stop && *c != '\n') ++c;  // skip to next EOL
+  const auto* eol = static_cast<const char*>(std::memchr(c, '\n', stop - c));
+  c = eol ? eol : stop;  // skip to next EOL
   const char* d = c;
   while (d-- > *start && *d == '\r')
     ;  // trim potential CR
@@ -291,7 +326,8 @@ std::string_view read_paragraph(const char** start, const char* const stop) {
   const char* c = *start;
   const char* d;
   do {
-    while (c < stop && *c != '\n') ++c;  // skip to next EOL
+    const auto* eol = static_cast<const char*>(std::memchr(c, '\n', stop - c));
+    c = eol ? eol : stop;  // skip to next EOL
     d = c++;
     while (d < stop && (*d == '\n' || *d == '\r')) ++d;
   } while (d < stop && d == c);
@@ -315,8 +351,9 @@ SentenceStream::SentenceStream(const char* data, size_t size,
   static Regex r(".*", PCRE2_UTF);
   thread_local static Match m(r);
 
-  if (verify_utf8) {
-    // pre-flight verification: make sure it's well-formed UTF8
+  // pre-flight verification: make sure it's well-formed UTF8. PCRE2 is only
+  // asked to find where it is not, for the error message.
+  if (verify_utf8 && !scan::valid_utf8(data, data + size)) {
     int success = r.find(std::string_view(data, size), &m);
     if (success < 0) {
       auto offset = pcre2_get_startchar(m.match_data);
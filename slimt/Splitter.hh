@@ -3,7 +3,6 @@
 
 #include <functional>
 #include <iosfwd>
-#include <map>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -25,7 +24,17 @@ class Splitter {
   std::string_view operator()(std::string_view* rest) const;
 
  private:
-  using PrefixMap = std::map<std::string, int, std::less<>>;
+  // Transparent, so that lookups with std::string_view do not construct a
+  // std::string for every candidate boundary.
+  struct PrefixHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view prefix) const {
+      return std::hash<std::string_view>()(prefix);
+    }
+  };
+
+  using PrefixMap =
+      std::unordered_map<std::string, int, PrefixHash, std::equal_to<>>;
   PrefixMap prefix_type_;
 
   // Return the prefix class of a prefix.
@@ -0,0 +1,481 @@
+#include "slimt/Store.hh"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "slimt/Model.hh"
+#include "slimt/Types.hh"
+#include "slimt/Vocabulary.hh"
+
+namespace slimt {
+
+namespace {
+
+constexpr uint64_t kPreamble = 2 * sizeof(uint64_t);
+
+// Records start at multiples of this, so that their fields are aligned in the
+// mapping.
+constexpr uint64_t kRecordAlign = alignof(uint64_t);
+
+// The mapping reaches past the end of the file, so that appends are found
+// without remapping until the file outgrows it.
+constexpr size_t kMinimumMapping = 1 << 20;
+
+uint32_t fnv1a(uint32_t hash, const void *data, size_t size) {
+  constexpr uint32_t kPrime = 0x01000193;
+  const auto *bytes = reinterpret_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * kPrime;
+  }
+  return hash;
+}
+
+uint64_t padded(uint64_t size) {
+  return (size + kRecordAlign - 1) / kRecordAlign * kRecordAlign;
+}
+
+bool write_all(int fd, const std::string &bytes, uint64_t offset) {
+  size_t written = 0;
+  while (written < bytes.size()) {
+    ssize_t ret = pwrite(fd, bytes.data() + written, bytes.size() - written,
+                         static_cast<off_t>(offset + written));
+    if (ret == -1 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return false;
+    }
+    written += ret;
+  }
+  return true;
+}
+
+std::string preamble() {
+  std::string bytes(kPreamble, '\0');
+  uint64_t magic = TranslationStore::kMagic;
+  uint64_t version = TranslationStore::kVersion;
+  std::memcpy(bytes.data(), &magic, sizeof(magic));
+  std::memcpy(bytes.data() + sizeof(magic), &version, sizeof(version));
+  return bytes;
+}
+
+// Without alignments of its own, each target word is taken to align with
+// the source word at the same relative position, and EOS with EOS.
+Alignment monotonic(size_t source, size_t target) {
+  Alignment alignment(target, Distribution(source, 0.0F));
+  for (size_t t = 0; t < target; t++) {
+    size_t s = target > 1 ? t * (source - 1) / (target - 1) : source - 1;
+    alignment[t][s] = 1.0F;
+  }
+  return alignment;
+}
+
+}  // namespace
+
+TranslationStore::TranslationStore(const std::string &path) : path_(path) {
+  open();
+}
+
+TranslationStore::~TranslationStore() { close(); }
+
+void TranslationStore::open() {
+  fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ == -1) {
+    throw std::runtime_error("Failed to open translation store: " + path_);
+  }
+
+  // Another process writing the file may be midway through an append, which
+  // scan() would take for a torn record. Without the lock, only read.
+  writable_ = flock(fd_, LOCK_EX | LOCK_NB) == 0;
+  if (!writable_) {
+    if (errno != EWOULDBLOCK) {
+      close();
+      throw std::runtime_error("Failed to lock translation store: " + path_);
+    }
+    std::cerr << "Translation store " << path_
+              << " is locked by another writer, opening it read-only.\n";
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) == -1) {
+    close();
+    throw std::runtime_error("Failed to stat translation store: " + path_);
+  }
+
+  end_ = st.st_size;
+  if (!writable_ && end_ < kPreamble) {
+    // Created by the writer, which has yet to write the preamble.
+    end_ = 0;
+    return;
+  }
+
+  if (end_ == 0) {
+    if (!write_all(fd_, preamble(), 0)) {
+      close();
+      throw std::runtime_error("Failed to write translation store: " + path_);
+    }
+    end_ = kPreamble;
+  }
+
+  remap();
+  if (end_ < kPreamble ||
+      std::memcmp(data_, preamble().data(), kPreamble) != 0) {
+    close();
+    throw std::runtime_error("Not a translation store of this version: " +
+                             path_);
+  }
+
+  scan(kPreamble);
+}
+
+void TranslationStore::close() {
+  if (data_ != nullptr) {
+    munmap(data_, mapped_);
+    data_ = nullptr;
+    mapped_ = 0;
+  }
+  if (fd_ != -1) {
+    // Closing releases the lock.
+    ::close(fd_);
+    fd_ = -1;
+  }
+  writable_ = false;
+  index_.clear();
+  size_ = 0;
+  end_ = 0;
+}
+
+void TranslationStore::remap() const {
+  if (end_ <= mapped_) {
+    return;
+  }
+
+  size_t size = std::max<size_t>(2 * end_, kMinimumMapping);
+  void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED) {  // NOLINT
+    throw std::runtime_error("Failed to mmap translation store: " + path_);
+  }
+  if (data_ != nullptr) {
+    munmap(data_, mapped_);
+  }
+  data_ = data;
+  mapped_ = size;
+}
+
+void TranslationStore::scan(uint64_t offset) {
+  const char *base = reinterpret_cast<const char *>(data_);
+  while (offset + sizeof(Record) <= end_) {
+    Record header = *record(offset);
+    uint64_t size = extent(header);
+    if (offset + size > end_) {
+      break;
+    }
+
+    uint32_t checksum = header.checksum;
+    header.checksum = 0;
+    uint32_t expected = fnv1a(0x811c9dc5, &header, sizeof(header));
+    expected = fnv1a(expected, base + offset + sizeof(Record),
+                     payload(header));
+    if (checksum != expected) {
+      break;
+    }
+
+    insert(offset);
+    offset += size;
+  }
+
+  if (offset < end_ && !writable_) {
+    end_ = offset;
+  } else if (offset < end_) {
+    std::cerr << "Truncating translation store " << path_ << " at " << offset
+              << " of " << end_ << " bytes.\n";
+    if (ftruncate(fd_, static_cast<off_t>(offset)) == -1) {
+      throw std::runtime_error("Failed to truncate translation store: " +
+                               path_);
+    }
+    end_ = offset;
+  }
+}
+
+uint64_t TranslationStore::payload(const Record &header) {
+  uint64_t words = uint64_t(header.source) + header.target;
+  uint64_t floats = uint64_t(header.target) * header.width;
+  return words * sizeof(Word) + floats * sizeof(float);
+}
+
+uint64_t TranslationStore::extent(const Record &header) {
+  return padded(sizeof(Record) + payload(header));
+}
+
+const TranslationStore::Record *TranslationStore::record(
+    uint64_t offset) const {
+  const char *base = reinterpret_cast<const char *>(data_);
+  return reinterpret_cast<const Record *>(base + offset);
+}
+
+bool TranslationStore::matches(uint64_t offset,
+                               const CacheQuery &query) const {
+  const Record *header = record(offset);
+  if (header->model != query.model || header->source != query.words.size()) {
+    return false;
+  }
+  const auto *source = reinterpret_cast<const Word *>(header + 1);
+  return std::equal(query.words.begin(), query.words.end(), source);
+}
+
+void TranslationStore::insert(uint64_t offset) {
+  const Record *header = record(offset);
+  const auto *source = reinterpret_cast<const Word *>(header + 1);
+  Words words(source, source + header->source);
+  CacheQuery query{.model = header->model, .words = words};
+
+  std::vector<uint64_t> &offsets = index_[CacheKeyHash()(query)];
+  for (uint64_t &existing : offsets) {
+    if (matches(existing, query)) {
+      existing = offset;
+      return;
+    }
+  }
+  offsets.push_back(offset);
+  ++size_;
+}
+
+uint64_t TranslationStore::locate(const CacheQuery &query) const {
+  auto bucket = index_.find(CacheKeyHash()(query));
+  if (bucket == index_.end()) {
+    return 0;
+  }
+  for (uint64_t offset : bucket->second) {
+    if (matches(offset, query)) {
+      return offset;
+    }
+  }
+  return 0;
+}
+
+History TranslationStore::find(const CacheQuery &query) const {
+  auto read = [this, &query]() -> History {
+    uint64_t offset = locate(query);
+    if (offset == 0) {
+      return nullptr;
+    }
+
+    const Record *header = record(offset);
+    const auto *target =
+        reinterpret_cast<const Word *>(header + 1) + header->source;
+    const auto *alignment =
+        reinterpret_cast<const float *>(target + header->target);
+
+    auto hypothesis = std::make_shared<Hypothesis>();
+    hypothesis->target.assign(target, target + header->target);
+    if (header->width != 0) {
+      hypothesis->alignment.reserve(header->target);
+      for (size_t t = 0; t < header->target; t++) {
+        const float *row = alignment + t * header->width;
+        hypothesis->alignment.emplace_back(row, row + header->width);
+      }
+    }
+    return hypothesis;
+  };
+
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (end_ <= mapped_) {
+      return read();
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  remap();
+  return read();
+}
+
+void TranslationStore::append(const CacheKey &key, const History &history) {
+  if (!writable_) {
+    return;
+  }
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  write(key, *history);
+}
+
+void TranslationStore::write(const CacheKey &key,
+                             const Hypothesis &hypothesis) {
+  const Alignment &alignment = hypothesis.alignment;
+  bool aligned = !alignment.empty() &&
+                 alignment.size() == hypothesis.target.size() &&
+                 std::all_of(alignment.begin(), alignment.end(),
+                             [&alignment](const Distribution &row) {
+                               return row.size() == alignment.front().size();
+                             });
+
+  uint32_t width = aligned ? alignment.front().size() : 0;
+  Record header{
+      .model = key.model,                                         //
+      .source = static_cast<uint32_t>(key.words.size()),          //
+      .target = static_cast<uint32_t>(hypothesis.target.size()),  //
+      .width = width,                                             //
+      .checksum = 0                                               //
+  };
+
+  std::string bytes(sizeof(Record), '\0');
+  auto put = [&bytes](const void *data, size_t size) {
+    bytes.append(reinterpret_cast<const char *>(data), size);
+  };
+  put(key.words.data(), key.words.size() * sizeof(Word));
+  put(hypothesis.target.data(), hypothesis.target.size() * sizeof(Word));
+  if (aligned) {
+    for (const Distribution &row : alignment) {
+      put(row.data(), row.size() * sizeof(float));
+    }
+  }
+
+  uint32_t checksum = fnv1a(0x811c9dc5, &header, sizeof(header));
+  header.checksum = fnv1a(checksum, bytes.data() + sizeof(Record),
+                          bytes.size() - sizeof(Record));
+  std::memcpy(bytes.data(), &header, sizeof(header));
+  bytes.resize(padded(bytes.size()), '\0');
+
+  if (!write_all(fd_, bytes, end_)) {
+    std::cerr << "Failed to append to translation store " << path_ << "\n";
+    return;
+  }
+
+  uint64_t offset = end_;
+  end_ += bytes.size();
+  remap();
+  insert(offset);
+}
+
+size_t TranslationStore::preload(const Model &model, const std::string &tsv) {
+  if (!writable_) {
+    return 0;
+  }
+
+  std::ifstream in(tsv);
+  if (!in) {
+    throw std::runtime_error("Failed to open translation memory: " + tsv);
+  }
+
+  const Vocabulary &vocabulary = model.vocabulary();
+  auto tokenize = [&vocabulary](std::string_view text) {
+    Words words;
+    Views views;
+    vocabulary.encode(text, words, views);
+    words.push_back(vocabulary.eos_id());
+    return words;
+  };
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  remap();
+
+  size_t added = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos) {
+      continue;
+    }
+
+    std::string_view text(line);
+    CacheKey key{
+        .model = model.fingerprint(),          //
+        .words = tokenize(text.substr(0, tab))  //
+    };
+    CacheQuery query{.model = key.model, .words = key.words};
+    if (locate(query) != 0) {
+      continue;
+    }
+
+    Hypothesis hypothesis;
+    hypothesis.target = tokenize(text.substr(tab + 1));
+    hypothesis.alignment =
+        monotonic(key.words.size(), hypothesis.target.size());
+    write(key, hypothesis);
+    ++added;
+  }
+  return added;
+}
+
+void TranslationStore::compact() {
+  if (!writable_) {
+    return;
+  }
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  remap();
+
+  // The staging file is locked before it is renamed into place, so that the
+  // lock passes from the old file to the new without a moment unheld, in
+  // which another process could take it.
+  std::string staging = path_ + ".tmp." + std::to_string(getpid());
+  int fd = ::open(staging.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1 || flock(fd, LOCK_EX | LOCK_NB) == -1) {
+    std::cerr << "Failed to compact translation store to " << staging << "\n";
+    if (fd != -1) {
+      ::close(fd);
+      std::remove(staging.c_str());
+    }
+    return;
+  }
+
+  // Records keep their relative order, though not their offsets.
+  std::vector<uint64_t> offsets;
+  offsets.reserve(size_);
+  for (const auto &[hash, bucket] : index_) {
+    offsets.insert(offsets.end(), bucket.begin(), bucket.end());
+  }
+  std::sort(offsets.begin(), offsets.end());
+
+  const char *base = reinterpret_cast<const char *>(data_);
+  std::string bytes = preamble();
+  for (uint64_t offset : offsets) {
+    bytes.append(base + offset, extent(*record(offset)));
+  }
+
+  bool written = write_all(fd, bytes, 0) && fsync(fd) == 0;
+  if (!written || std::rename(staging.c_str(), path_.c_str()) != 0) {
+    std::cerr << "Failed to compact translation store " << path_ << "\n";
+    ::close(fd);
+    std::remove(staging.c_str());
+    return;
+  }
+
+  // The old file is unlinked, so closing it gives up nothing another process
+  // can find.
+  munmap(data_, mapped_);
+  data_ = nullptr;
+  mapped_ = 0;
+  ::close(fd_);
+  fd_ = fd;
+  end_ = bytes.size();
+  index_.clear();
+  size_ = 0;
+  remap();
+  scan(kPreamble);
+}
+
+size_t TranslationStore::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return size_;
+}
+
+}  // namespace slimt
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "slimt/Export.hh"
+#include "slimt/Types.hh"
+
+namespace slimt {
+
+class Model;
+
+/// TranslationStore keeps segment translations in a file, so that a process
+/// starting up finds what earlier ones translated instead of a cold cache.
+///
+/// The file is an append-only log of records, each holding the key (Model
+/// fingerprint and source words), the target words and alignment. It is
+/// mapped into memory, and an index from key hash to record offset built on
+/// opening. Workers append records as they translate, which lookups find
+/// through the index, remapping the file once it has grown past the mapping.
+///
+/// A record torn by a crash fails its checksum and is truncated away on
+/// opening. Later records for a key supersede earlier ones, which stay in the
+/// file until compact() rewrites it.
+///
+/// Layout: magic, version, then records, each a Record followed by source
+/// words, target words and target x width alignment floats.
+///
+/// Only one process writes a file at a time, holding an exclusive lock on it
+/// while open. Another process opening the file meanwhile gets it read-only:
+/// it finds what was stored before it opened, and stores nothing.
+class SLIMT_EXPORT TranslationStore {
+ public:
+  constexpr static uint64_t kMagic = 0x534C494D54545354;
+  constexpr static uint64_t kVersion = 1;
+
+  /// Opens the file at path, creating it if absent.
+  explicit TranslationStore(const std::string &path);
+  ~TranslationStore();
+
+  TranslationStore(const TranslationStore &) = delete;
+  TranslationStore &operator=(const TranslationStore &) = delete;
+
+  /// @returns the stored translation of query, or nullptr.
+  History find(const CacheQuery &query) const;
+
+  /// Appends the translation of key, superseding any stored before.
+  void append(const CacheKey &key, const History &history);
+
+  /// Reads a translation memory of tab-separated source and target, one
+  /// segment per line, tokenized with the vocabulary of model. Targets get a
+  /// monotonic alignment, having none of their own. Sources already stored
+  /// are skipped.
+  /// @returns number of segments added, 0 if opened read-only.
+  size_t preload(const Model &model, const std::string &tsv);
+
+  /// Rewrites the file with only the latest record of each key, under a
+  /// temporary name renamed into place, locked before it is. Does nothing if
+  /// opened read-only.
+  void compact();
+
+  /// Number of distinct keys stored.
+  size_t size() const;
+
+  /// Whether this holds the lock on the file, or opened it read-only.
+  bool writable() const { return writable_; }
+
+ private:
+  struct Record {
+    uint64_t model;
+    uint32_t source;
+    uint32_t target;
+    uint32_t width;
+    uint32_t checksum;
+  };
+
+  void open();
+  void close();
+
+  /// Maps the file up to end_, if the mapping stops short of it.
+  void remap() const;
+
+  /// Indexes records from offset to the end of the file, truncating it at
+  /// the first invalid one.
+  void scan(uint64_t offset);
+
+  /// Bytes of words and alignment following a Record, and of the whole
+  /// record with padding.
+  static uint64_t payload(const Record &header);
+  static uint64_t extent(const Record &header);
+
+  const Record *record(uint64_t offset) const;
+  bool matches(uint64_t offset, const CacheQuery &query) const;
+
+  /// Indexes the record at offset, superseding an earlier record of its key.
+  void insert(uint64_t offset);
+
+  /// Offset of the record of query in the index, or 0.
+  uint64_t locate(const CacheQuery &query) const;
+
+  void write(const CacheKey &key, const Hypothesis &hypothesis);
+
+  std::string path_;
+  int fd_ = -1;
+  bool writable_ = false;
+  uint64_t end_ = 0;
+
+  mutable void *data_ = nullptr;
+  mutable size_t mapped_ = 0;
+
+  // Hashes collide rarely, so buckets are almost always a single offset.
+  std::unordered_map<size_t, std::vector<uint64_t>> index_;
+  size_t size_ = 0;
+
+  mutable std::shared_mutex mutex_;
+};
+
+}  // namespace slimt
@@ -2,7 +2,8 @@
 
 #include <algorithm>
 #include <cstddef>
-#include <iterator>
+#include <future>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -12,7 +13,9 @@
 #include "slimt/Aligned.hh"
 #include "slimt/Annotation.hh"
 #include "slimt/Macros.hh"
+#include "slimt/Metrics.hh"
 #include "slimt/Splitter.hh"
+#include "slimt/ThreadPool.hh"
 #include "slimt/Types.hh"
 #include "slimt/Vocabulary.hh"
 
@@ -62,15 +65,30 @@ Splitter load_splitter(const Aligned &memory) {
   return splitter;
 }
 
+// Lines are independent, except in wrapped text where paragraphs are, and a
+// paragraph ends at a newline followed by empty lines.
+std::string_view separator(SentenceStream::splitmode mode) {
+  return mode == SentenceStream::splitmode::WrappedText ? "\n\n" : "\n";
+}
+
+// Extends a boundary just past a separator over the rest of the empty lines.
+size_t skip_empty_lines(std::string_view text, size_t boundary,
+                        SentenceStream::splitmode mode) {
+  while (mode == SentenceStream::splitmode::WrappedText &&
+         boundary < text.size() &&
+         (text[boundary] == '\n' || text[boundary] == '\r')) {
+    ++boundary;
+  }
+  return boundary;
+}
+
 }  // namespace
 
 Segment TextProcessor::tokenize(
     const std::string_view &segment,
     std::vector<std::string_view> &word_ranges) const {
-  auto [words, views] = vocabulary_.encode(segment, /*add_eos=*/false);
-  word_ranges.reserve(word_ranges.size() +
-                      distance(views.begin(), views.end()));
-  word_ranges.insert(word_ranges.end(), views.begin(), views.end());
+  Words words;
+  vocabulary_.encode(segment, words, word_ranges);
   return words;
 }
 
@@ -95,13 +113,73 @@ TextProcessor::TextProcessor(const std::string &mode,
 
 std::tuple<AnnotatedText, Segments> TextProcessor::process(
     std::string &&input, size_t wrap_length) const {
+  Metrics::Scope scope(Stage::kPreprocess);
   AnnotatedText source(std::move(input));
   Segments segments;
   std::string_view input_converted(source.text.data(), source.text.size());
-  auto sentence_stream = SentenceStream(input_converted, ssplit_, ssplit_mode_);
+  std::optional<std::vector<Tokenized>> sentences = split(input_converted);
+  if (sentences) {
+    for (Tokenized &sentence : *sentences) {
+      // Wrap segment into sentences of at most wrap_length_ tokens and
+      // tell source about them.
+      wrap(sentence.segment, sentence.word_ranges, segments, source,
+           wrap_length);
+    }
+  }
+  return {std::move(source), std::move(segments)};
+}
 
-  std::string_view sentence_string_piece;
+std::tuple<AnnotatedText, Segments> TextProcessor::process(
+    std::string &&input, size_t wrap_length, ThreadPool &pool) const {
+  AnnotatedText source(std::move(input));
+  std::string_view input_converted(source.text.data(), source.text.size());
+  std::vector<std::string_view> chunks = chunk(input_converted);
+  if (chunks.size() <= 1) {
+    return process(std::move(source.text), wrap_length);
+  }
+
+  Metrics::Scope scope(Stage::kPreprocess);
+
+  using Sentences = std::optional<std::vector<Tokenized>>;
+  ThreadPool::Group group;
+  std::vector<std::future<Sentences>> futures;
+  futures.reserve(chunks.size());
+  for (std::string_view text : chunks) {
+    futures.push_back(
+        pool.submit(group, [this, text]() { return split(text); }));
+  }
+
+  std::vector<Sentences> chunked;
+  chunked.reserve(chunks.size());
+  for (auto &future : futures) {
+    chunked.push_back(pool.wait(group, future));
+  }
 
+  // Recording sentences into source has to happen in order, so chunks are
+  // merged here, serially. A chunk with invalid UTF-8 invalidates the whole
+  // input, as it would have processed whole.
+  Segments segments;
+  auto valid = [](const Sentences &sentences) { return sentences.has_value(); };
+  if (std::all_of(chunked.begin(), chunked.end(), valid)) {
+    for (Sentences &sentences : chunked) {
+      for (Tokenized &sentence : *sentences) {
+        wrap(sentence.segment, sentence.word_ranges, segments, source,
+             wrap_length);
+      }
+    }
+  }
+  return {std::move(source), std::move(segments)};
+}
+
+std::optional<std::vector<TextProcessor::Tokenized>> TextProcessor::split(
+    std::string_view text) const {
+  auto sentence_stream = SentenceStream(text, ssplit_, ssplit_mode_);
+  if (!sentence_stream.error_message().empty()) {
+    return std::nullopt;
+  }
+
+  std::vector<Tokenized> sentences;
+  std::string_view sentence_string_piece;
   while (sentence_stream >> sentence_string_piece) {
     std::string_view sentence(sentence_string_piece.data(),
                               sentence_string_piece.size());
@@ -112,12 +190,41 @@ std::tuple<AnnotatedText, Segments> TextProcessor::process(
     // There are some cases where SentencePiece or vocab returns no words
     // after normalization. 0 prevents any empty entries from being added.
     if (!segment.empty()) {
-      // Wrap segment into sentences of at most wrap_length_ tokens and
-      // tell source about them.
-      wrap(segment, word_ranges, segments, source, wrap_length);
+      sentences.push_back({std::move(segment), std::move(word_ranges)});
     }
   }
-  return {std::move(source), std::move(segments)};
+  return sentences;
+}
+
+std::vector<std::string_view> TextProcessor::chunk(
+    std::string_view text) const {
+  std::string_view breaks = separator(ssplit_mode_);
+  std::vector<std::string_view> chunks;
+  while (text.size() > kChunkSize) {
+    size_t boundary = text.find(breaks, kChunkSize);
+    if (boundary == std::string_view::npos) {
+      break;
+    }
+
+    boundary = skip_empty_lines(text, boundary + breaks.size(), ssplit_mode_);
+    chunks.push_back(text.substr(0, boundary));
+    text.remove_prefix(boundary);
+  }
+  chunks.push_back(text);
+  return chunks;
+}
+
+size_t TextProcessor::boundary(std::string_view text, size_t from) const {
+  std::string_view breaks = separator(ssplit_mode_);
+
+  // A separator may straddle from, starting just before it.
+  size_t start = from > breaks.size() ? from - breaks.size() + 1 : 0;
+  size_t boundary = text.substr(start).rfind(breaks);
+  if (boundary == std::string_view::npos) {
+    return 0;
+  }
+  return skip_empty_lines(text, start + boundary + breaks.size(),
+                          ssplit_mode_);
 }
 
 void TextProcessor::wrap(Segment &segment,
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -13,6 +14,7 @@
 namespace slimt {
 class Aligned;
 class AnnotatedText;
+class ThreadPool;
 class Vocabulary;
 
 class TextProcessor {
@@ -35,9 +37,41 @@ class TextProcessor {
 
   std::tuple<AnnotatedText, Segments> process(std::string &&input,
                                               size_t wrap_length) const;
+
+  /// As above, but splits and tokenizes chunks of input in parallel on pool.
+  /// Chunks break only where a sentence cannot span (lines, or paragraphs for
+  /// wrapped text), so the result is the same as processing input whole.
+  std::tuple<AnnotatedText, Segments> process(std::string &&input,
+                                              size_t wrap_length,
+                                              ThreadPool &pool) const;
+
   std::tuple<AnnotatedText, Segments> process(AnnotatedText &source) const;
 
+  /// Length of the longest prefix of text that ends where no sentence can
+  /// continue past (a line, or a paragraph for wrapped text), 0 if there is
+  /// none. Text up to there processes the same regardless of what follows.
+  /// Text before offset from is known to hold no boundary, and is not searched
+  /// again.
+  size_t boundary(std::string_view text, size_t from = 0) const;
+
  private:
+  /// A sentence tokenized, prior to wrapping.
+  struct Tokenized {
+    Segment segment;
+    std::vector<std::string_view> word_ranges;
+  };
+
+  /// Bytes of input to aim for in each chunk processed in parallel.
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  /// Splits text into sentences and tokenizes each. Returns nullopt if text is
+  /// not valid UTF-8, in which case no sentences are to be translated.
+  std::optional<std::vector<Tokenized>> split(std::string_view text) const;
+
+  /// Breaks text into chunks of about kChunkSize at boundaries sentences do
+  /// not span in ssplit_mode_.
+  std::vector<std::string_view> chunk(std::string_view text) const;
+
   /// Tokenizes an input string, returns Words corresponding. Loads the
   /// corresponding byte-ranges into word_ranges.
   Segment tokenize(const std::string_view &segment,
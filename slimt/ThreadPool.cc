@@ -0,0 +1,75 @@
+#include "slimt/ThreadPool.hh"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace slimt {
+
+ThreadPool::ThreadPool(size_t workers) {
+  for (size_t i = 0; i < workers; i++) {
+    workers_.emplace_back([this]() {
+      while (true) {
+        std::shared_ptr<Job> job;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          work_.wait(lock, [this]() { return shutdown_ || !jobs_.empty(); });
+          if (jobs_.empty()) {
+            return;
+          }
+          job = std::move(jobs_.front());
+          jobs_.pop_front();
+        }
+        // A thread waiting on its group may have run it already.
+        run(*job);
+      }
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    shutdown_ = true;
+  }
+  work_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::enqueue(std::shared_ptr<Job> job) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    jobs_.push_back(std::move(job));
+  }
+  work_.notify_one();
+}
+
+bool ThreadPool::run(Job &job) {
+  if (!job.claim()) {
+    return false;
+  }
+  job.run();
+
+  // The queue or group may hold on to job a while yet; what the task
+  // captured need not live as long.
+  job.run = nullptr;
+  return true;
+}
+
+bool ThreadPool::run_one(Group &group) {
+  while (!group.jobs_.empty()) {
+    std::shared_ptr<Job> job = std::move(group.jobs_.front());
+    group.jobs_.pop_front();
+    if (run(*job)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace slimt
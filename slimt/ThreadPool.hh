@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace slimt {
+
+/// A fixed set of threads running tasks submitted from anywhere, in order of
+/// submission. Tasks may submit tasks of their own and wait on them through
+/// wait(), which runs those still queued meanwhile, so that a pool busy with
+/// waiting tasks cannot deadlock.
+class ThreadPool {
+  struct Job {
+    std::function<void()> run;
+    std::atomic<bool> claimed = false;
+
+    /// Whether the caller is the first to claim this job, and so runs it.
+    bool claim() { return !claimed.exchange(true, std::memory_order_acq_rel); }
+  };
+
+ public:
+  /// Tasks submitted together, which a thread waiting on one of them helps
+  /// run. It runs only tasks of its own group, so that it is never held up
+  /// behind unrelated work it picked up meanwhile. A Group is used from one
+  /// thread, the one submitting to and waiting on it.
+  class Group {
+   private:
+    friend class ThreadPool;
+    std::deque<std::shared_ptr<Job>> jobs_;
+  };
+
+  explicit ThreadPool(size_t workers);
+
+  /// Runs tasks already submitted to completion, then joins the threads.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  template <class Task>
+  auto submit(Task &&task) -> std::future<std::invoke_result_t<Task>> {
+    auto [job, future] = make_job(std::forward<Task>(task));
+    enqueue(std::move(job));
+    return std::move(future);
+  }
+
+  template <class Task>
+  auto submit(Group &group, Task &&task)
+      -> std::future<std::invoke_result_t<Task>> {
+    // Jobs already taken by a worker have nothing left to help with.
+    while (!group.jobs_.empty() && group.jobs_.front()->claimed.load()) {
+      group.jobs_.pop_front();
+    }
+
+    auto [job, future] = make_job(std::forward<Task>(task));
+    group.jobs_.push_back(job);
+    enqueue(std::move(job));
+    return std::move(future);
+  }
+
+  /// Waits for future, running tasks of group still queued on this thread in
+  /// the meantime.
+  template <class Result>
+  Result wait(Group &group, std::future<Result> &future) {
+    while (future.wait_for(std::chrono::seconds(0)) !=
+           std::future_status::ready) {
+      // Nothing of group queued means what future waits on is running.
+      if (!run_one(group)) {
+        future.wait();
+      }
+    }
+    return future.get();
+  }
+
+  size_t size() const { return workers_.size(); }
+
+ private:
+  template <class Task>
+  static auto make_job(Task &&task) {
+    using Result = std::invoke_result_t<Task>;
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<Task>(task));
+    std::future<Result> future = packaged->get_future();
+    auto job = std::make_shared<Job>();
+    job->run = [packaged]() { (*packaged)(); };
+    return std::make_pair(std::move(job), std::move(future));
+  }
+
+  void enqueue(std::shared_ptr<Job> job);
+
+  /// Runs job if no other thread has claimed it. @returns whether it ran.
+  static bool run(Job &job);
+
+  /// Runs one queued task of group on the calling thread, if any.
+  static bool run_one(Group &group);
+
+  std::vector<std::thread> workers_;
+  std::deque<std::shared_ptr<Job>> jobs_;
+  bool shutdown_ = false;
+
+  std::mutex mutex_;
+  std::condition_variable work_;
+};
+
+}  // namespace slimt
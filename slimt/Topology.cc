@@ -0,0 +1,190 @@
+#include "slimt/Topology.hh"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace slimt {
+
+namespace {
+
+const std::string kNodes = "/sys/devices/system/node";
+const std::string kCPUs = "/sys/devices/system/cpu";
+
+// Contents of a sysfs CPU list file, empty if unreadable.
+Topology::CPUs read_cpus(const std::string &path) {
+  std::ifstream file(path);
+  std::string list;
+  if (!file || !std::getline(file, list)) {
+    return {};
+  }
+  return parse_cpus(list);
+}
+
+Topology::CPUs allowed() {
+  Topology::CPUs cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (size_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    size_t count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t cpu = 0; cpu < count; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// Those of cpus also in permitted, which is sorted.
+Topology::CPUs restrict(const Topology::CPUs &cpus,
+                        const Topology::CPUs &permitted) {
+  Topology::CPUs kept;
+  for (size_t cpu : cpus) {
+    if (std::binary_search(permitted.begin(), permitted.end(), cpu)) {
+      kept.push_back(cpu);
+    }
+  }
+  return kept;
+}
+
+}  // namespace
+
+Topology::CPUs parse_cpus(const std::string &list) {
+  Topology::CPUs cpus;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    size_t dash = range.find('-');
+    try {
+      size_t first = std::stoul(range.substr(0, dash));
+      size_t last = dash == std::string::npos
+                        ? first
+                        : std::stoul(range.substr(dash + 1));
+      for (size_t cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception &) {
+      // Blank or malformed ranges contribute nothing.
+    }
+  }
+  return cpus;
+}
+
+size_t Topology::node(size_t cpu) const {
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const CPUs &cpus = nodes[i];
+    if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+Topology Topology::detect() {
+  CPUs permitted = allowed();
+  Topology topology;
+
+  // Node directories are numbered, not necessarily contiguously.
+  std::error_code error;
+  std::set<std::string> directories;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(kNodes, error)) {
+    std::string name = entry.path().filename().string();
+    if (name.rfind("node", 0) == 0 && name.size() > 4 &&
+        std::isdigit(static_cast<unsigned char>(name[4]))) {
+      directories.insert(entry.path().string());
+    }
+  }
+
+  for (const std::string &directory : directories) {
+    CPUs cpus = restrict(read_cpus(directory + "/cpulist"), permitted);
+    if (!cpus.empty()) {
+      topology.nodes.push_back(std::move(cpus));
+    }
+  }
+
+  if (topology.nodes.empty()) {
+    topology.nodes.push_back(permitted);
+  }
+
+  // index3 is the L3 on x86 and most ARM servers; CPUs without one report
+  // their own node as cache domain.
+  std::set<CPUs> caches;
+  for (size_t cpu : permitted) {
+    std::string path = kCPUs + "/cpu" + std::to_string(cpu) +
+                       "/cache/index3/shared_cpu_list";
+    CPUs cpus = restrict(read_cpus(path), permitted);
+    if (cpus.empty()) {
+      cpus = topology.nodes[topology.node(cpu)];
+    }
+    caches.insert(std::move(cpus));
+  }
+  topology.caches.assign(caches.begin(), caches.end());
+  return topology;
+}
+
+Placement place(const Topology &topology, const std::string &mode,
+                size_t worker) {
+  size_t node = worker % topology.nodes.size();
+  size_t rank = worker / topology.nodes.size();
+  const Topology::CPUs &cpus = topology.nodes[node];
+
+  Placement placement{.node = node, .cpus = {}};
+  if (mode == "node") {
+    placement.cpus = cpus;
+  } else if (mode == "core") {
+    placement.cpus = {cpus[rank % cpus.size()]};
+  } else if (mode == "cache") {
+    std::vector<const Topology::CPUs *> local;
+    for (const Topology::CPUs &cache : topology.caches) {
+      if (topology.node(cache.front()) == node) {
+        local.push_back(&cache);
+      }
+    }
+    placement.cpus = local.empty() ? cpus : *local[rank % local.size()];
+  } else {
+    placement.node = 0;
+  }
+  return placement;
+}
+
+bool pin(const Topology::CPUs &cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  // 0 is the calling thread, not the whole process.
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+}  // namespace slimt
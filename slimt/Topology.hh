@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace slimt {
+
+/// CPUs this process may run on, grouped by NUMA node and by shared last level
+/// cache (a CCX on AMD parts), as Linux reports them under sysfs. Where those
+/// are unavailable, all CPUs make one node and one cache domain.
+struct Topology {
+  using CPUs = std::vector<size_t>;
+
+  std::vector<CPUs> nodes;
+  std::vector<CPUs> caches;
+
+  /// Index into nodes of the node holding cpu.
+  size_t node(size_t cpu) const;
+
+  static Topology detect();
+};
+
+/// Where a worker runs: the node it belongs to, and CPUs to pin it to, none
+/// for no pinning.
+struct Placement {
+  size_t node;
+  Topology::CPUs cpus;
+};
+
+/// Places worker under mode, one of "core", "cache" or "node" (anything else
+/// places nothing). Workers go round-robin over nodes, so that each node gets
+/// its share, and within a node, to a core or cache domain of their own while
+/// there are enough to go around.
+Placement place(const Topology &topology, const std::string &mode,
+                size_t worker);
+
+/// Restricts the calling thread to cpus.
+/// @returns false if the OS refused, or does not support pinning.
+bool pin(const Topology::CPUs &cpus);
+
+/// Parses a sysfs CPU list, such as "0-3,8,10-11".
+Topology::CPUs parse_cpus(const std::string &list);
+
+}  // namespace slimt
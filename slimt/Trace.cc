@@ -0,0 +1,217 @@
+#include "slimt/Trace.hh"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace slimt {
+
+namespace {
+
+// Threads are numbered in order of first recording, which reads better in
+// the timeline than OS thread ids.
+std::atomic<size_t> next_thread = 0;
+
+void escape(std::string_view text, std::string &out) {
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char code[8];
+          snprintf(code, sizeof(code), "\\u%04x", c);
+          out += code;
+        } else {
+          out += c;
+        }
+    }
+  }
+}
+
+// Trace-event timestamps are microseconds.
+std::string microseconds(uint64_t nanoseconds) {
+  constexpr uint64_t kNanoPerMicro = 1000;
+  return std::to_string(nanoseconds / kNanoPerMicro) + "." +
+         std::to_string(nanoseconds % kNanoPerMicro / 100);
+}
+
+}  // namespace
+
+std::atomic<bool> Tracer::enabled_ = false;
+
+Tracer &Tracer::instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+uint64_t Tracer::now() {
+  auto since = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(since).count();
+}
+
+Tracer::Buffer &Tracer::buffer() {
+  thread_local std::shared_ptr<Buffer> buffer = nullptr;
+  if (!buffer) {
+    buffer = std::make_shared<Buffer>();
+    buffer->thread = next_thread++;
+    std::lock_guard<std::mutex> guard(mutex_);
+    buffers_.push_back(buffer);
+  }
+  return *buffer;
+}
+
+void Tracer::start() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (const std::shared_ptr<Buffer> &buffer : buffers_) {
+    std::lock_guard<std::mutex> buffer_guard(buffer->mutex);
+    buffer->events.clear();
+  }
+  epoch_ = now();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+bool Tracer::stop(const std::string &path) {
+  enabled_.store(false, std::memory_order_relaxed);
+
+  std::ofstream out(path);
+  std::lock_guard<std::mutex> guard(mutex_);
+  size_t pid = getpid();
+  std::string json = "{\"traceEvents\":[\n";
+  bool first = true;
+  auto separate = [&json, &first]() {
+    if (!first) {
+      json += ",\n";
+    }
+    first = false;
+  };
+
+  for (const std::shared_ptr<Buffer> &buffer : buffers_) {
+    std::lock_guard<std::mutex> buffer_guard(buffer->mutex);
+    std::string tid = std::to_string(buffer->thread);
+    if (!buffer->name.empty()) {
+      separate();
+      json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" +
+              std::to_string(pid) + ",\"tid\":" + tid +
+              ",\"args\":{\"name\":\"";
+      escape(buffer->name, json);
+      json += "\"}}";
+    }
+
+    for (const Event &event : buffer->events) {
+      // Spans begun before start() have nothing to be placed against.
+      if (event.start < epoch_) {
+        continue;
+      }
+      separate();
+      json += "{\"name\":\"";
+      escape(event.name, json);
+      json += "\",\"cat\":\"";
+      json += event.category;
+      json += "\",\"ph\":\"X\",\"ts\":" + microseconds(event.start - epoch_) +
+              ",\"dur\":" + microseconds(event.duration) +
+              ",\"pid\":" + std::to_string(pid) + ",\"tid\":" + tid +
+              ",\"args\":{" + event.args + "}}";
+    }
+    buffer->events.clear();
+  }
+  json += "\n]}\n";
+
+  // Threads since exited hold no reference of their own any more.
+  buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                [](const std::shared_ptr<Buffer> &buffer) {
+                                  return buffer.use_count() == 1;
+                                }),
+                 buffers_.end());
+
+  out << json;
+  return static_cast<bool>(out);
+}
+
+size_t Tracer::buffered() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  size_t events = 0;
+  for (const std::shared_ptr<Buffer> &buffer : buffers_) {
+    std::lock_guard<std::mutex> buffer_guard(buffer->mutex);
+    events += buffer->events.size();
+  }
+  return events;
+}
+
+void Tracer::name(const std::string &name) {
+  Buffer &buffer = this->buffer();
+  std::lock_guard<std::mutex> guard(buffer.mutex);
+  buffer.name = name;
+}
+
+void Tracer::record(std::string &&name, const char *category, uint64_t start,
+                    uint64_t duration, std::string &&args) {
+  Buffer &buffer = this->buffer();
+  std::lock_guard<std::mutex> guard(buffer.mutex);
+  buffer.events.push_back(Event{
+      .name = std::move(name),  //
+      .category = category,     //
+      .start = start,           //
+      .duration = duration,     //
+      .args = std::move(args)   //
+  });
+}
+
+void Span::begin(std::string_view name, const char *category) {
+  name_ = name;
+  category_ = category;
+  start_ = Tracer::now();
+}
+
+void Span::end() {
+  uint64_t duration = Tracer::now() - start_;
+  Tracer::instance().record(std::move(name_), category_, start_, duration,
+                            std::move(args_));
+}
+
+void Span::arg(std::string_view key, size_t value) {
+  if (!active_) {
+    return;
+  }
+  if (!args_.empty()) {
+    args_ += ",";
+  }
+  args_ += "\"";
+  escape(key, args_);
+  args_ += "\":" + std::to_string(value);
+}
+
+void Span::arg(std::string_view key, std::string_view value) {
+  if (!active_) {
+    return;
+  }
+  if (!args_.empty()) {
+    args_ += ",";
+  }
+  args_ += "\"";
+  escape(key, args_);
+  args_ += "\":\"";
+  escape(value, args_);
+  args_ += "\"";
+}
+
+}  // namespace slimt
@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "slimt/Export.hh"
+
+namespace slimt {
+
+/// Records spans of work on every thread into a timeline, written as Chrome
+/// trace-event JSON, which chrome://tracing and Perfetto open. Batches,
+/// encoder and decoder steps and matrix multiplies each make a span, so that
+/// idle gaps between batches and their shapes show per worker.
+///
+/// Tracing is off unless started. Spans then cost one branch on a flag.
+/// Started, each thread appends to a buffer of its own, so that threads do
+/// not contend on recording.
+class SLIMT_EXPORT Tracer {
+ public:
+  static Tracer &instance();
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /// Starts recording, dropping anything recorded before.
+  void start();
+
+  /// Stops recording, and writes everything recorded to path.
+  /// @returns false if path could not be written.
+  bool stop(const std::string &path);
+
+  /// Events recorded and not yet written, across threads.
+  size_t buffered();
+
+  /// Names the calling thread in the timeline.
+  void name(const std::string &name);
+
+  /// A span named name, in category, from start for duration nanoseconds.
+  /// args is the body of a JSON object, possibly empty.
+  void record(std::string &&name, const char *category, uint64_t start,
+              uint64_t duration, std::string &&args);
+
+  /// Nanoseconds since an arbitrary epoch, fixed through the process.
+  static uint64_t now();
+
+ private:
+  struct Event {
+    std::string name;
+    const char *category;
+    uint64_t start;
+    uint64_t duration;
+    std::string args;
+  };
+
+  struct Buffer {
+    size_t thread;
+    std::string name;
+    std::mutex mutex;
+    std::vector<Event> events;
+  };
+
+  Tracer() = default;
+
+  /// Buffer of the calling thread, created on first use.
+  Buffer &buffer();
+
+  static std::atomic<bool> enabled_;
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Buffer>> buffers_;
+  uint64_t epoch_ = 0;
+};
+
+/// Records a span from construction to destruction, if tracing is enabled at
+/// construction. Arguments show with the span in the timeline.
+class SLIMT_EXPORT Span {
+ public:
+  explicit Span(std::string_view name, const char *category = "slimt")
+      : active_(Tracer::enabled()) {
+    if (active_) {
+      begin(name, category);
+    }
+  }
+
+  ~Span() {
+    if (active_) {
+      end();
+    }
+  }
+
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+
+  explicit operator bool() const { return active_; }
+
+  void arg(std::string_view key, size_t value);
+  void arg(std::string_view key, std::string_view value);
+
+ private:
+  void begin(std::string_view name, const char *category);
+  void end();
+
+  bool active_;
+  std::string name_;
+  const char *category_ = nullptr;
+  uint64_t start_ = 0;
+  std::string args_;
+};
+
+}  // namespace slimt
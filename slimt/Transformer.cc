@@ -1,5 +1,6 @@
 #include "slimt/Transformer.hh"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -13,6 +14,7 @@
 
 #include "slimt/Io.hh"
 #include "slimt/Modules.hh"
+#include "slimt/QMM.hh"
 #include "slimt/Tensor.hh"
 #include "slimt/TensorOps.hh"
 #include "slimt/Types.hh"
@@ -84,12 +86,67 @@ std::vector<Tensor> Decoder::start_states(size_t batch_size) const {
   return states;
 }
 
+namespace {
+
+// What besides the model blob decides the layout of prepared weights.
+std::string build(size_t encoder_layers, size_t decoder_layers,
+                  size_t num_heads, size_t feed_forward_depth) {
+  return qmm::backend() + ";" + std::to_string(encoder_layers) + "," +
+         std::to_string(decoder_layers) + "," + std::to_string(num_heads) +
+         "," + std::to_string(feed_forward_depth);
+}
+
+// Attaches to prepared weights at path, provided they were prepared from the
+// same model blob by the same build.
+io::Shared attach(const std::string &path, uint64_t digest,
+                  const std::string &build) {
+  if (path.empty()) {
+    return io::Shared();
+  }
+
+  io::Shared shared(path);
+  if (shared.attached() && shared.fingerprint() != digest) {
+    std::cerr << "Shared weights at " << path << " were prepared from a ";
+    std::cerr << "different model, preparing and publishing anew.\n";
+    return io::Shared();
+  }
+  if (shared.attached() && shared.build() != build) {
+    std::cerr << "Shared weights at " << path << " were prepared for ";
+    std::cerr << shared.build() << ", not " << build << ", preparing ";
+    std::cerr << "and publishing anew.\n";
+    return io::Shared();
+  }
+  return shared;
+}
+
+}  // namespace
+
 Transformer::Transformer(size_t encoder_layers, size_t decoder_layers,
                          size_t num_heads, size_t feed_forward_depth,
-                         View model)
-    : items_(io::load_items(model.data)),
+                         View model, const std::string &shared)
+    : Transformer(encoder_layers, decoder_layers, num_heads,
+                  feed_forward_depth, model, shared,
+                  shared.empty() ? 0 : io::digest(model)) {}
+
+Transformer::Transformer(size_t encoder_layers, size_t decoder_layers,
+                         size_t num_heads, size_t feed_forward_depth,
+                         View model, const std::string &shared,
+                         uint64_t digest)
+    : shared_(attach(shared, digest,
+                     build(encoder_layers, decoder_layers, num_heads,
+                           feed_forward_depth))),
+      items_(io::load_items(model.data, &shared_)),
       encoder_(encoder_layers, num_heads, feed_forward_depth),  //
       decoder_(decoder_layers, num_heads, feed_forward_depth, embedding_) {
+  // Whatever is there, missing, stale or of another model, is replaced, so
+  // that later processes attach rather than prepare their own. Publishing
+  // renames into place, so processes mapping the file before keep theirs.
+  if (!shared.empty() && !shared_.attached()) {
+    io::Shared::publish(shared, digest,
+                        build(encoder_layers, decoder_layers, num_heads,
+                              feed_forward_depth),
+                        items_);
+  }
   load_parameters();
 }
 
@@ -117,9 +174,10 @@ void Decoder::register_parameters(const std::string &prefix,
   }
 }
 
-std::tuple<Tensor, Tensor> Decoder::step(
-    const Tensor &encoder_out, const Tensor &mask, std::vector<Tensor> &states,
-    const Words &previous_step, const std::optional<Words> &shortlist) const {
+std::tuple<Tensor, Tensor> Decoder::hidden(const Tensor &encoder_out,
+                                           const Tensor &mask,
+                                           std::vector<Tensor> &states,
+                                           const Words &previous_step) const {
   // Infer batch-size from encoder_out.
   size_t encoder_feature_dim = encoder_out.dim(-1);
   size_t source_sequence_length = encoder_out.dim(-2);
@@ -148,11 +206,23 @@ std::tuple<Tensor, Tensor> Decoder::step(
     // Maybe move this to some new construct?
     Tensor indices(Type::i32, std::move(shape), name);
     int *data = indices.data<int>();
+    bool starting = false;
     for (size_t batch_id = 0; batch_id < batch_size; batch_id++) {
-      data[batch_id] = previous_step[batch_id];
+      Word word = previous_step[batch_id];
+      starting = starting || word == kStart;
+      data[batch_id] = word == kStart ? 0 : word;
     }
 
     Tensor embedding = index_select(embedding_, indices);
+    if (starting) {
+      auto *rows = embedding.data<float>();
+      for (size_t batch_id = 0; batch_id < batch_size; batch_id++) {
+        if (previous_step[batch_id] == kStart) {
+          float *row = rows + batch_id * embed_dim;
+          std::fill(row, row + embed_dim, 0.0F);
+        }
+      }
+    }
     return embedding;
   };
 
@@ -173,6 +243,14 @@ std::tuple<Tensor, Tensor> Decoder::step(
     }
   }
 
+  return {std::move(x), std::move(guided_alignment)};
+}
+
+std::tuple<Tensor, Tensor> Decoder::step(
+    const Tensor &encoder_out, const Tensor &mask, std::vector<Tensor> &states,
+    const Words &previous_step, const std::optional<Words> &shortlist) const {
+  auto [x, guided_alignment] = hidden(encoder_out, mask, states, previous_step);
+
   if (shortlist) {
     Tensor logits = affine_with_select(output_, x, *shortlist, "logits");
     return {std::move(logits), std::move(guided_alignment)};
@@ -182,6 +260,39 @@ std::tuple<Tensor, Tensor> Decoder::step(
   return {std::move(logits), std::move(guided_alignment)};
 }
 
+std::tuple<std::vector<Tensor>, Tensor> Decoder::step(
+    const Tensor &encoder_out, const Tensor &mask, std::vector<Tensor> &states,
+    const Words &previous_step, const std::vector<Words> &shortlists,
+    size_t group_size) const {
+  auto [x, guided_alignment] = hidden(encoder_out, mask, states, previous_step);
+
+  // Each group multiplies its rows of x, viewed in place, against only the
+  // columns its own shortlist selects.
+  size_t batch_size = x.dim(0);
+  size_t row_bytes = x.view().size / batch_size;
+  auto *data = reinterpret_cast<char *>(x.view().data);
+
+  std::vector<Tensor> logits;
+  for (size_t g = 0; g < shortlists.size(); g++) {
+    size_t begin = g * group_size;
+    size_t rows = std::min(group_size, batch_size - begin);
+
+    Shape shape = x.shape();
+    shape.set_dim(0, static_cast<int>(rows));
+    View view{
+        .data = data + begin * row_bytes,  //
+        .size = rows * row_bytes           //
+    };
+
+    Tensor group;
+    group.load(view, x.type(), std::move(shape), "decoder_out_group");
+    logits.push_back(
+        affine_with_select(output_, group, shortlists[g], "logits"));
+  }
+
+  return {std::move(logits), std::move(guided_alignment)};
+}
+
 void Transformer::load_parameters() {
   // Get the parameterss from strings to target tensors to load.
   ParameterMap parameters;
@@ -224,6 +335,14 @@ void Transformer::load_parameters() {
   }
 }
 
+size_t Transformer::footprint() const {
+  size_t bytes = 0;
+  for (const io::Item &item : items_) {
+    bytes += item.aligned.size();
+  }
+  return bytes;
+}
+
 void Transformer::register_parameters(const std::string &prefix,
                                       ParameterMap &parameters) {
   parameters.emplace("Wemb", &embedding_);
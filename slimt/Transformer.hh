@@ -1,5 +1,7 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <string>
 #include <tuple>
@@ -30,13 +32,31 @@ class Decoder {
 
   void register_parameters(const std::string &prefix, ParameterMap &parameters);
 
+  /// Stands in previous_step for a sentence yet to decode its first word,
+  /// which starts from an empty embedding, as a wholly empty previous_step
+  /// does for every sentence.
+  static constexpr Word kStart = std::numeric_limits<Word>::max();
+
   std::vector<Tensor> start_states(size_t batch_size) const;
   std::tuple<Tensor, Tensor> step(const Tensor &encoder_out, const Tensor &mask,
                                   std::vector<Tensor> &states,
                                   const Words &previous_step,
                                   const std::optional<Words> &shortlist) const;
 
+  /// Steps as above, but computes logits separately for consecutive groups of
+  /// group_size sentences, each over its own shortlist. Returns logits for
+  /// every group along with the guided alignment for the whole batch.
+  std::tuple<std::vector<Tensor>, Tensor> step(
+      const Tensor &encoder_out, const Tensor &mask,
+      std::vector<Tensor> &states, const Words &previous_step,
+      const std::vector<Words> &shortlists, size_t group_size) const;
+
  private:
+  std::tuple<Tensor, Tensor> hidden(const Tensor &encoder_out,
+                                    const Tensor &mask,
+                                    std::vector<Tensor> &states,
+                                    const Words &previous_step) const;
+
   const Tensor &embedding_;
   std::vector<DecoderLayer> decoder_;
   Affine output_;
@@ -54,17 +74,31 @@ void transform_embedding(Tensor &word_embedding, size_t start = 0);
 
 class Transformer {
  public:
+  /// @param [in] shared: Path to prepared weights to map in from, or publish
+  /// to for other processes if absent or prepared from another blob or build.
+  /// Empty disables sharing.
   explicit Transformer(size_t encoder_layers, size_t decoder_layers,
-                       size_t num_heads, size_t feed_forward_depth, View model);
+                       size_t num_heads, size_t feed_forward_depth, View model,
+                       const std::string &shared = "");
 
   const Tensor &embedding() const { return embedding_; }
   const Encoder &encoder() const { return encoder_; }
   const Decoder &decoder() const { return decoder_; }
 
+  /// Bytes held by parameters prepared (and owned) at load, excluding those
+  /// pointing into the model blob.
+  size_t footprint() const;
+
  private:
+  /// digest is of model, taken only when sharing.
+  Transformer(size_t encoder_layers, size_t decoder_layers, size_t num_heads,
+              size_t feed_forward_depth, View model, const std::string &shared,
+              uint64_t digest);
+
   void register_parameters(const std::string &prefix, ParameterMap &parameters);
   void load_parameters();
 
+  io::Shared shared_;
   std::vector<io::Item> items_;
   Tensor embedding_;
   Encoder encoder_;
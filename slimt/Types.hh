@@ -59,9 +59,39 @@ struct Hypothesis {
 
 using History = Ptr<Hypothesis>;
 using Histories = std::vector<History>;
-using TranslationCache = AtomicCache<size_t, History>;
+
+/// Keys the translation cache on the Model and the full source segment, so
+/// that segments whose hashes collide never share a translation.
+struct CacheKey {
+  size_t model;
+  Words words;
+};
+
+/// Borrows the segment, for lookups not to copy it into a CacheKey.
+struct CacheQuery {
+  size_t model;
+  const Words &words;
+};
+
+struct CacheKeyHash {
+  using is_transparent = void;
+  size_t operator()(const CacheKey &key) const;
+  size_t operator()(const CacheQuery &query) const;
+};
+
+struct CacheKeyEquals {
+  using is_transparent = void;
+  template <class Key, class Query>
+  bool operator()(const Key &key, const Query &query) const {
+    return key.model == query.model && key.words == query.words;
+  }
+};
+
+using TranslationCache =
+    AtomicCache<CacheKey, History, CacheKeyHash, CacheKeyEquals>;
 
 struct Response;
+struct Partial;
 
 using Promise = std::promise<Response>;
 using Future = std::future<Response>;
@@ -2,8 +2,10 @@
 
 #include <sentencepiece_processor.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -21,61 +23,276 @@
 
 namespace slimt {
 
-Vocabulary::Vocabulary(View view) {
+namespace {
+
+constexpr std::string_view kProbe =
+    "The quick brown fox, aged 12, jumped over 3 lazy dogs. Didn't it?";
+
+// Whether line consists only of printable ASCII words separated by single
+// spaces. Normalization leaves such lines untouched, so they encode the same
+// word by word as they do whole.
+bool memoizable(std::string_view line) {
+  if (line.empty() || line.front() == ' ' || line.back() == ' ') {
+    return false;
+  }
+
+  char previous = 0;
+  for (char c : line) {
+    bool printable = c > ' ' && c < 0x7F;
+    if (!printable && (c != ' ' || previous == ' ')) {
+      return false;
+    }
+    previous = c;
+  }
+  return true;
+}
+
+}  // namespace
+
+Vocabulary::Vocabulary(View view) : memo_(kMemoSize, kMemoWays) {
   absl::string_view serialized(reinterpret_cast<char *>(view.data), view.size);
   processor_.LoadFromSerializedProto(serialized);
+  memoize_ = words_independent();
+  load_surfaces();
 }
 
-Vocabulary::Vocabulary(const std::string &fpath) {
+Vocabulary::Vocabulary(const std::string &fpath)
+    : memo_(kMemoSize, kMemoWays) {
   // Load vocabulary
   processor_.Load(fpath);
+  memoize_ = words_independent();
+  load_surfaces();
 }
 
 std::tuple<Words, Views> Vocabulary::encode(const std::string_view &line,
                                             bool add_eos /* = false*/) const {
-  absl::string_view a_line(line.data(), line.size());
-  std::vector<absl::string_view> views;
-  sentencepiece::SentencePieceText sentencepiece_text;
+  Words words;
+  Views views;
+  encode(line, words, views);
+
+  if (add_eos) {
+    uint32_t eos_id = processor_.eos_id();
+    words.push_back(eos_id);
+  }
+
+  return std::make_tuple(std::move(words), std::move(views));
+}
+
+void Vocabulary::encode(std::string_view line, Words &words,
+                        Views &views) const {
+  if (memoize_ && memoizable(line)) {
+    encode_words(line, words, views);
+  } else {
+    encode_pieces(line, words, views);
+  }
+}
+
+void Vocabulary::encode_words(std::string_view line, Words &words,
+                              Views &views) const {
+  size_t begin = 0;
+  while (begin < line.size()) {
+    size_t end = std::min(line.find(' ', begin), line.size());
+    Ptr<const Pieces> pieces = lookup(line.substr(begin, end - begin));
+
+    for (size_t i = 0; i < pieces->words.size(); i++) {
+      auto [piece_begin, piece_end] = pieces->spans[i];
+      size_t offset = begin + piece_begin;
+      size_t size = piece_end - piece_begin;
+
+      // The space before a word is what SentencePiece turns into the leading
+      // ▁ of its first piece, so the first piece spans it.
+      if (i == 0 && begin > 0) {
+        --offset;
+        ++size;
+      }
 
+      words.push_back(pieces->words[i]);
+      views.emplace_back(line.data() + offset, size);
+    }
+    begin = end + 1;
+  }
+}
+
+void Vocabulary::encode_pieces(std::string_view line, Words &words,
+                               Views &views) const {
+  // Reused across calls, so the protobuf keeps its allocations. Encode clears
+  // it before writing.
+  thread_local static sentencepiece::SentencePieceText sentencepiece_text;
+
+  absl::string_view a_line(line.data(), line.size());
   processor_.Encode(a_line, &sentencepiece_text);
   const auto &pieces = sentencepiece_text.pieces();
 
-  Words words;
-  words.reserve(pieces.size() + static_cast<uint32_t>(add_eos));
-
   // Deprecation warning on the other iterator, so accessing via index.
   // Then it claims use range loop sigh.
   // NOLINTNEXTLINE
   size_t piece_count = static_cast<size_t>(pieces.size());
+  words.reserve(words.size() + piece_count);
+  views.reserve(views.size() + piece_count);
   for (size_t i = 0; i < piece_count; i++) {
     const auto &piece = pieces[i];
-    Word word = piece.id();
-    words.push_back(word);
-    std::string_view view =
-        line.substr(piece.begin(), piece.end() - piece.begin());
-    views.emplace_back(view.data(), view.size());
+    words.push_back(piece.id());
+    views.push_back(line.substr(piece.begin(), piece.end() - piece.begin()));
   }
+}
 
-  if (add_eos) {
-    uint32_t eos_id = processor_.eos_id();
-    words.push_back(eos_id);
+Ptr<const Vocabulary::Pieces> Vocabulary::lookup(std::string_view word) const {
+  auto [found, pieces] = memo_.find(word);
+  if (found) {
+    return pieces;
+  }
+
+  Words words;
+  Views views;
+  encode_pieces(word, words, views);
+
+  auto encoded = std::make_shared<Pieces>();
+  encoded->words = std::move(words);
+  for (std::string_view view : views) {
+    auto piece_begin = static_cast<uint32_t>(view.data() - word.data());
+    auto piece_end = static_cast<uint32_t>(piece_begin + view.size());
+    encoded->spans.emplace_back(piece_begin, piece_end);
+  }
+
+  memo_.store(std::string(word), encoded);
+  return encoded;
+}
+
+bool Vocabulary::words_independent() const {
+  const auto &model = processor_.model_proto();
+  const auto &normalizer = model.normalizer_spec();
+  const auto &trainer = model.trainer_spec();
+
+  // Pieces must stop at spaces, and a space must become the ▁ leading the
+  // piece after it, as the dummy prefix does for a word encoded alone.
+  if (!trainer.split_by_whitespace() || trainer.treat_whitespace_as_suffix() ||
+      !normalizer.escape_whitespaces() || !normalizer.add_dummy_prefix() ||
+      !normalizer.remove_extra_whitespaces()) {
+    return false;
   }
 
-  // Sentencepiece uses absl::string_view all around. Since C++ treats
-  // absl::string_view and std::string_view as different classes despite the
-  // same layout and intent, this conversion is inevitable, unless we want to
-  // edit sentencepiece.
-  std::vector<std::string_view> std_views;
-  std_views.reserve(views.size());
-  for (const auto &view : views) {
-    std_views.emplace_back(view.data(), view.size());
+  // These rules leave printable ASCII as is. Others, like user-defined ones,
+  // may rewrite it in ways that depend on the neighbouring words.
+  const std::string &rule = normalizer.name();
+  if (rule != "identity" && rule != "nfkc" && rule != "nmt_nfkc") {
+    return false;
   }
 
-  return std::make_tuple(words, std_views);
+  // User-defined symbols spanning a space would join words.
+  using Piece = sentencepiece::ModelProto::SentencePiece;
+  constexpr std::string_view kSpaceSymbol = "\xe2\x96\x81";
+  for (const auto &piece : model.pieces()) {
+    std::string_view surface = piece.piece();
+    if (piece.type() == Piece::USER_DEFINED &&
+        surface.find(kSpaceSymbol, 1) != std::string_view::npos) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Vocabulary::load_surfaces() {
+  // Surfaces of every piece laid out flat, with ▁ already turned into spaces.
+  // Unknown and byte pieces decode depending on their neighbours, so words
+  // containing them are left to SentencePiece.
+  constexpr std::string_view kSpaceSymbol = "\xe2\x96\x81";
+  size_t piece_count = size();
+  surface_begin_.reserve(piece_count + 1);
+  contextual_.resize(piece_count);
+  for (size_t id = 0; id < piece_count; id++) {
+    surface_begin_.push_back(surfaces_.size());
+    auto piece_id = static_cast<int>(id);
+    contextual_[id] =
+        processor_.IsUnknown(piece_id) || processor_.IsByte(piece_id);
+    if (processor_.IsControl(piece_id)) {
+      continue;
+    }
+
+    std::string_view piece = processor_.IdToPiece(piece_id);
+    size_t position = 0;
+    while (position < piece.size()) {
+      if (piece.substr(position, kSpaceSymbol.size()) == kSpaceSymbol) {
+        surfaces_.push_back(' ');
+        position += kSpaceSymbol.size();
+      } else {
+        surfaces_.push_back(piece[position]);
+        position += 1;
+      }
+    }
+  }
+  surface_begin_.push_back(surfaces_.size());
+
+  flat_ = probe_decode();
+}
+
+bool Vocabulary::probe_decode() const {
+  auto [words, views] = encode(kProbe, /*add_eos=*/true);
+
+  std::string expected;
+  Views expected_views = decode_pieces(words, expected);
+
+  std::string decoded;
+  Views decoded_views = decode_surfaces(words, decoded);
+
+  auto same = [&](std::string_view lhs, std::string_view rhs) {
+    return lhs.data() - decoded.data() == rhs.data() - expected.data() &&
+           lhs.size() == rhs.size();
+  };
+
+  return decoded == expected &&
+         std::equal(decoded_views.begin(), decoded_views.end(),
+                    expected_views.begin(), expected_views.end(), same);
 }
 
 Views Vocabulary::decode(const Words &words, std::string &decoded,
                          bool ignore_eos) const {
+  auto contextual = [this](Word word) { return contextual_[word]; };
+  bool flat = flat_ && std::none_of(words.begin(), words.end(), contextual);
+
+  Views views =
+      flat ? decode_surfaces(words, decoded) : decode_pieces(words, decoded);
+  if (ignore_eos) {
+    views.pop_back();
+  }
+  return views;
+}
+
+Views Vocabulary::decode_surfaces(const Words &words,
+                                  std::string &decoded) const {
+  auto surface = [this](Word word) {
+    size_t begin = surface_begin_[word];
+    size_t size = surface_begin_[word + 1] - begin;
+    return std::string_view(surfaces_.data() + begin, size);
+  };
+
+  // Sized up front so that views taken while appending stay valid.
+  size_t length = 0;
+  for (Word word : words) {
+    length += surface(word).size();
+  }
+  decoded.clear();
+  decoded.reserve(length);
+
+  Views views;
+  views.reserve(words.size());
+  for (Word word : words) {
+    std::string_view piece = surface(word);
+
+    // Like SentencePiece, drop the space the dummy prefix introduced at the
+    // beginning of the text.
+    if (decoded.empty() && !piece.empty() && piece.front() == ' ') {
+      piece.remove_prefix(1);
+    }
+
+    size_t begin = decoded.size();
+    decoded.append(piece);
+    views.emplace_back(decoded.data() + begin, piece.size());
+  }
+  return views;
+}
+
+Views Vocabulary::decode_pieces(const Words &words,
+                                std::string &decoded) const {
   sentencepiece::SentencePieceText sentencepiece_text;
   std::vector<std::string_view> views;
 
@@ -96,10 +313,6 @@ Views Vocabulary::decode(const Words &words, std::string &decoded,
     views.push_back(view);
   }
 
-  if (ignore_eos) {
-    views.pop_back();
-  }
-
   return views;
 }
 
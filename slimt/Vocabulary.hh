@@ -2,30 +2,99 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include "sentencepiece_processor.h"
+#include "slimt/Cache.hh"
+#include "slimt/Export.hh"
 #include "slimt/Types.hh"
 
 namespace slimt {
 
-class Vocabulary {
+class SLIMT_EXPORT Vocabulary {
  public:
   explicit Vocabulary(const std::string &fpath);
   explicit Vocabulary(View view);
   std::tuple<Words, Views> encode(const std::string_view &line,
                                   bool add_eos = false) const;
+
+  /// Appends ids of line to words, and the span of line each covers to views.
+  /// Lines of space-separated ASCII words are encoded word by word through a
+  /// memo of recent words, skipping SentencePiece for words seen before.
+  void encode(std::string_view line, Words &words, Views &views) const;
+
+  /// As encode(), but always through SentencePiece, bypassing the memo.
+  void encode_pieces(std::string_view line, Words &words, Views &views) const;
+
+  /// Whether this model encodes words alike alone or within a line, so that
+  /// encode() may go through the memo.
+  bool memoizes() const { return memoize_; }
+
   Views decode(const Words &words, std::string &decoded,
                bool ignore_eos = true) const;
 
+  /// As decode(), but always through SentencePiece, bypassing the flat table
+  /// of surfaces, and keeping the view of any EOS.
+  Views decode_pieces(const Words &words, std::string &decoded) const;
+
+  /// Whether decode() goes through the flat table of surfaces for words with
+  /// no unknown or byte pieces, having found it agrees with SentencePiece.
+  bool decodes_flat() const { return flat_; }
+
   Word pad_id() const { return std::max(0, processor_.pad_id()); }
   Word eos_id() const { return processor_.eos_id(); }
   size_t size() const { return processor_.GetPieceSize(); }
 
  private:
+  // Ids of a word encoded on its own, and the [begin, end) span within the
+  // word each covers.
+  struct Pieces {
+    Words words;
+    std::vector<std::pair<uint32_t, uint32_t>> spans;
+  };
+
+  static constexpr size_t kMemoSize = 1 << 14;
+  static constexpr size_t kMemoWays = 8;
+
+  // Hashes std::string and std::string_view alike, so lookups by view do not
+  // construct a string.
+  struct MemoHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view word) const {
+      return std::hash<std::string_view>()(word);
+    }
+  };
+
+  void encode_words(std::string_view line, Words &words, Views &views) const;
+  Ptr<const Pieces> lookup(std::string_view word) const;
+
+  // Whether the normalizer and trainer specs of this model make encoding word
+  // by word agree with encoding whole lines.
+  bool words_independent() const;
+
+  void load_surfaces();
+  Views decode_surfaces(const Words &words, std::string &decoded) const;
+
+  // Checks concatenating surfaces agrees with SentencePiece decoding.
+  bool probe_decode() const;
+
   sentencepiece::SentencePieceProcessor processor_;
+  mutable AtomicCache<std::string, Ptr<const Pieces>, MemoHash,
+                      std::equal_to<>>
+      memo_;
+  bool memoize_ = false;
+
+  // surfaces_[surface_begin_[id], surface_begin_[id + 1]) is what id decodes
+  // to, for ids not marked contextual_.
+  std::string surfaces_;
+  std::vector<size_t> surface_begin_;
+  std::vector<bool> contextual_;
+  bool flat_ = false;
 };
 
 }  // namespace slimt
@@ -280,4 +280,11 @@ void prepare_weight_quantized_transposed<Provider::Gemmology>(
   PrepareBQuantizedTransposed(input, output, rows, cols);
 }
 
+template <>
+std::string backend<Provider::Gemmology>() {
+  auto name = xsimd::dispatch<GEMMOLOGY_SUPPORTED_ARCHS>(
+      [](auto arch) { return std::string(decltype(arch)::name()); });
+  return "gemmology/" + name();
+}
+
 }  // namespace slimt::qmm::detail
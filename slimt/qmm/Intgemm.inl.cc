@@ -241,4 +241,10 @@ void prepare_weight_quantized_transposed<Provider::Intgemm>(const int8_t* input,
                                                             size_t cols) {
   intgemm::Int8::PrepareBQuantizedTransposed(input, output, rows, cols);
 }
+
+template <>
+std::string backend<Provider::Intgemm>() {
+  return "intgemm/" + std::to_string(static_cast<int>(intgemm::kCPU));
+}
+
 }  // namespace slimt::qmm::detail
@@ -272,4 +272,10 @@ void prepare_weight_quantized_transposed<Provider::Ruy>(const int8_t* input,
   std::memcpy(output, input,
               /*count=*/sizeof(int8_t) * (rows * cols));
 }
+
+// Ruy prepares by quantizing alone, which is the same on every CPU.
+template <>
+std::string backend<Provider::Ruy>() {
+  return "ruy";
+}
 }  // namespace slimt::qmm::detail
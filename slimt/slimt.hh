@@ -1,4 +1,7 @@
 #pragma once
 #include "slimt/Frontend.hh"
+#include "slimt/Metrics.hh"
 #include "slimt/Model.hh"
+#include "slimt/Registry.hh"
+#include "slimt/Trace.hh"
 #include "slimt/Version.hh"
@@ -0,0 +1,159 @@
+// Times the prefix lookup the splitter makes at every candidate sentence
+// boundary, against how it was done before: a regex for the last token and an
+// ordered map. Then times splitting as a whole. Input is generated from a
+// fixed seed, so runs are comparable across builds and machines.
+//
+// Usage: slimt_bench_splitter [prefixes] [sentences]
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "slimt/Regex.hh"
+#include "slimt/Splitter.hh"
+
+namespace {
+
+using slimt::Match;
+using slimt::Regex;
+
+struct Hash {
+  using is_transparent = void;
+  size_t operator()(std::string_view key) const {
+    return std::hash<std::string_view>()(key);
+  }
+};
+
+template <class Fn>
+double seconds(Fn &&fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+std::string word(std::mt19937 &generator, size_t length, bool capital) {
+  std::uniform_int_distribution<int> letter(0, 25);
+  std::string generated;
+  for (size_t i = 0; i < length; i++) {
+    char base = (capital && i == 0) ? 'A' : 'a';
+    generated.push_back(static_cast<char>(base + letter(generator)));
+  }
+  return generated;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t prefix_count = argc > 1 ? std::stoul(argv[1]) : 1000;
+  size_t sentence_count = argc > 2 ? std::stoul(argv[2]) : 200000;
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<size_t> length(2, 6);
+
+  // Prefixes as a nonbreaking prefix file has them, some numeric only.
+  std::vector<std::string> prefixes;
+  std::string prefix_file;
+  for (size_t i = 0; i < prefix_count; i++) {
+    prefixes.push_back(word(generator, length(generator), true));
+    prefix_file += prefixes.back();
+    prefix_file += i % 10 == 0 ? " #NUMERIC_ONLY#\n" : "\n";
+  }
+
+  // Sentences of a few words, a third of them with an abbreviation, which
+  // makes a candidate boundary that is not one. Pieces are what the splitter
+  // looks up at each candidate: the text up to the period.
+  std::uniform_int_distribution<size_t> pick(0, prefix_count - 1);
+  std::string text;
+  std::vector<std::string> pieces;
+  for (size_t i = 0; i < sentence_count; i++) {
+    std::string sentence = word(generator, length(generator), true);
+    for (size_t j = 0; j < 6; j++) {
+      sentence += " ";
+      if (j == 3 && i % 3 == 0) {
+        sentence += prefixes[pick(generator)];
+        pieces.push_back(sentence);
+        sentence += ".";
+      } else {
+        sentence += word(generator, length(generator), false);
+      }
+    }
+    pieces.push_back(sentence);
+    text += sentence + ". ";
+  }
+
+  std::map<std::string, int, std::less<>> ordered;
+  std::unordered_map<std::string, int, Hash, std::equal_to<>> hashed;
+  for (size_t i = 0; i < prefixes.size(); i++) {
+    int type = i % 10 == 0 ? 2 : 1;
+    ordered.emplace(prefixes[i], type);
+    hashed.emplace(prefixes[i], type);
+  }
+
+  Regex last_token(".*\\s([^\\s]*)", PCRE2_DOTALL);
+  Match match(last_token);
+  size_t found_before = 0;
+  double before = seconds([&]() {
+    for (const std::string &piece : pieces) {
+      std::string_view view = piece;
+      if (last_token.consume(&view, &match, PCRE2_NO_UTF_CHECK) > 0) {
+        view = match[1];
+      }
+      auto query = ordered.find(view);
+      found_before += query != ordered.end() ? query->second : 0;
+    }
+  });
+
+  auto whitespace = [](char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+  };
+  size_t found_after = 0;
+  double after = seconds([&]() {
+    for (const std::string &piece : pieces) {
+      std::string_view view = piece;
+      auto last = std::find_if(view.rbegin(), view.rend(), whitespace);
+      if (last != view.rend()) {
+        view.remove_prefix(view.rend() - last);
+      }
+      auto query = hashed.find(view);
+      found_after += query != hashed.end() ? query->second : 0;
+    }
+  });
+
+  if (found_before != found_after) {
+    std::fprintf(stderr, "Lookups disagree: %zu != %zu\n", found_before,
+                 found_after);
+    return 1;
+  }
+
+  slimt::Splitter splitter;
+  splitter.load_from_serialized(prefix_file);
+  size_t sentences = 0;
+  double split = seconds([&]() {
+    std::string_view rest = text;
+    while (!splitter(&rest).empty()) {
+      ++sentences;
+    }
+  });
+
+  auto rate = [](size_t count, double elapsed) {
+    return static_cast<double>(count) / elapsed / 1e6;
+  };
+  std::printf("%zu prefixes, %zu lookups, %.1f MB of text\n", prefix_count,
+              pieces.size(), static_cast<double>(text.size()) / 1e6);
+  std::printf("lookup, regex and map:     %8.3f s  %8.2f M/s\n", before,
+              rate(pieces.size(), before));
+  std::printf("lookup, scan and hash map: %8.3f s  %8.2f M/s\n", after,
+              rate(pieces.size(), after));
+  std::printf("split:                     %8.3f s  %8.2f MB/s, %zu sentences\n",
+              split, rate(text.size(), split), sentences);
+  return 0;
+}
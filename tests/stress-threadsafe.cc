@@ -0,0 +1,115 @@
+// Drives Threadsafe with many producers and consumers over a backend that
+// only collects, so that the queue itself is all there is to time. Checks
+// every item enqueued is generated exactly once, and reports throughput, to
+// measure changes to the queue against.
+//
+// Usage: slimt_stress_threadsafe [producers] [consumers] [items per producer]
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "slimt/Batcher.hh"
+
+namespace {
+
+// Stands in for Batcher: items go in one at a time, and come out in batches.
+class Backend {
+ public:
+  static constexpr size_t kBatch = 32;
+
+  size_t enqueue(size_t item) {
+    items_.push_back(item);
+    return 1;
+  }
+
+  std::tuple<std::vector<size_t>> generate() {
+    size_t count = std::min(kBatch, items_.size());
+    std::vector<size_t> batch(items_.end() - count, items_.end());
+    items_.resize(items_.size() - count);
+    return {std::move(batch)};
+  }
+
+  void clear() { items_.clear(); }
+
+ private:
+  std::vector<size_t> items_;
+};
+
+// Runs producers and consumers through a queue, and returns seconds taken, or
+// a negative number if any item was lost or generated twice.
+double run(size_t producers, size_t consumers, size_t items) {
+  slimt::Threadsafe<Backend> queue;
+  std::vector<std::vector<size_t>> seen(consumers);
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> consuming;
+  for (size_t i = 0; i < consumers; i++) {
+    consuming.emplace_back([&queue, &seen, i]() {
+      while (true) {
+        auto [batch] = queue.generate();
+        if (batch.empty()) {
+          return;
+        }
+        seen[i].insert(seen[i].end(), batch.begin(), batch.end());
+      }
+    });
+  }
+
+  std::vector<std::thread> producing;
+  for (size_t i = 0; i < producers; i++) {
+    producing.emplace_back([&queue, items, i]() {
+      for (size_t j = 0; j < items; j++) {
+        queue.enqueue(i * items + j);
+      }
+    });
+  }
+
+  for (std::thread &thread : producing) {
+    thread.join();
+  }
+  queue.shutdown();
+  for (std::thread &thread : consuming) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::vector<size_t> all;
+  for (const std::vector<size_t> &some : seen) {
+    all.insert(all.end(), some.begin(), some.end());
+  }
+  std::sort(all.begin(), all.end());
+  for (size_t i = 0; i < all.size(); i++) {
+    if (all[i] != i) {
+      return -1;
+    }
+  }
+  return all.size() == producers * items ? elapsed.count() : -1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  size_t producers = argc > 1 ? std::stoul(argv[1]) : 8;
+  size_t consumers = argc > 2 ? std::stoul(argv[2]) : 8;
+  size_t items = argc > 3 ? std::stoul(argv[3]) : 100000;
+
+  double elapsed = run(producers, consumers, items);
+  if (elapsed < 0) {
+    std::fprintf(stderr, "Items lost or generated twice\n");
+    return 1;
+  }
+
+  auto rate = static_cast<double>(producers * items) / elapsed / 1e6;
+  std::printf("%zu producers, %zu consumers, %zu items each\n", producers,
+              consumers, items);
+  std::printf("threadsafe: %8.3f s  %8.2f M/s\n", elapsed, rate);
+  return 0;
+}
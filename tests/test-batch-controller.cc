@@ -0,0 +1,122 @@
+// Feeds BatchController batches whose time follows a synthetic cost model,
+// and checks the budget settles where batches take the target latency, moves
+// towards it when the cost changes, stays within [1, max_words], and stays at
+// max_words with no target.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "slimt/Batcher.hh"
+
+namespace {
+
+using slimt::BatchController;
+
+size_t failures = 0;
+
+void check(bool pass, const std::string &name) {
+  if (!pass) {
+    ++failures;
+    std::printf("[FAIL] %s\n", name.c_str());
+  }
+}
+
+// Seconds a batch of tokens takes: a fixed cost per batch and one per token.
+struct Cost {
+  double batch;
+  double token;
+
+  double operator()(size_t tokens) const {
+    return batch + token * static_cast<double>(tokens);
+  }
+};
+
+// Runs batches of the budget the controller gives, as a worker would.
+void run(BatchController &controller, const Cost &cost, size_t batches) {
+  for (size_t i = 0; i < batches; i++) {
+    size_t tokens = controller.budget();
+    controller.record(tokens, cost(tokens));
+  }
+}
+
+}  // namespace
+
+int main() {
+  constexpr size_t kMaxWords = 4096;
+  constexpr size_t kTarget = 50;  // Milliseconds.
+  constexpr double kSeconds = 0.05;
+
+  // No target: the budget is max_words, however long batches take.
+  {
+    BatchController controller(kMaxWords, 0);
+    run(controller, Cost{.batch = 1.0, .token = 0.01}, 100);
+    run(controller, Cost{.batch = 0.0, .token = 1e-9}, 100);
+    check(controller.budget() == kMaxWords, "no target");
+    check(controller.state().batches == 200, "no target, recorded");
+  }
+
+  // Empty batches say nothing of cost, and are not recorded.
+  {
+    BatchController controller(kMaxWords, kTarget);
+    controller.record(0, 1.0);
+    check(controller.budget() == kMaxWords, "empty batch, budget");
+    check(controller.state().batches == 0, "empty batch, recorded");
+  }
+
+  // Settles on batches taking the target, fixed cost included.
+  {
+    Cost cost{.batch = 0.01, .token = 2e-5};
+    BatchController controller(kMaxWords, kTarget);
+    run(controller, cost, 200);
+    double goal = (kSeconds - cost.batch) / cost.token;
+    auto budget = static_cast<double>(controller.budget());
+    check(std::abs(budget - goal) < 0.02 * goal, "settles, budget");
+    check(std::abs(cost(controller.budget()) - kSeconds) < 0.02 * kSeconds,
+          "settles, batch time");
+    BatchController::State state = controller.state();
+    check(std::abs(state.latency - kSeconds) < 0.02 * kSeconds,
+          "settles, latency");
+
+    // Tokens turning twice as costly, the budget falls towards the new goal
+    // without overshooting it, and settles there.
+    Cost slower{.batch = cost.batch, .token = 2 * cost.token};
+    double slower_goal = (kSeconds - slower.batch) / slower.token;
+    bool towards = true;
+    for (size_t i = 0; i < 200; i++) {
+      double before = std::abs(static_cast<double>(controller.budget()) -
+                               slower_goal);
+      run(controller, slower, 1);
+      double after = std::abs(static_cast<double>(controller.budget()) -
+                              slower_goal);
+      towards = towards && after <= before + 1;
+    }
+    check(towards, "slows down, moves towards goal");
+    budget = static_cast<double>(controller.budget());
+    check(std::abs(budget - slower_goal) < 0.02 * slower_goal,
+          "slows down, settles");
+
+    // And back up again once tokens are cheap.
+    run(controller, cost, 200);
+    budget = static_cast<double>(controller.budget());
+    check(std::abs(budget - goal) < 0.02 * goal, "speeds up, settles");
+  }
+
+  // A target unreachable even with one token bottoms out at one.
+  {
+    BatchController controller(kMaxWords, kTarget);
+    run(controller, Cost{.batch = 1.0, .token = 0.1}, 50);
+    check(controller.budget() == 1, "too slow, lower bound");
+  }
+
+  // A target above what max_words takes stays at max_words.
+  {
+    BatchController controller(kMaxWords, kTarget);
+    run(controller, Cost{.batch = 0.0, .token = 1e-7}, 50);
+    check(controller.budget() == kMaxWords, "fast, upper bound");
+  }
+
+  std::printf("[%s] batch controller\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// Checks AtomicCache tells apart keys whose hashes collide, that CLOCK keeps
+// an entry hit between stores while others in its set come and go, and that
+// evictions of hot entries count as conflicts.
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "slimt/Cache.hh"
+
+namespace {
+
+// Every key lands on the same set with the same hash, so that only comparing
+// keys tells them apart.
+struct Colliding {
+  size_t operator()(const std::string & /*key*/) const { return 42; }
+};
+
+using Cache = slimt::AtomicCache<std::string, std::string, Colliding>;
+
+size_t failures = 0;
+
+void check(bool pass, const std::string &name) {
+  if (!pass) {
+    ++failures;
+    std::printf("[FAIL] %s\n", name.c_str());
+  }
+}
+
+bool holds(const Cache &cache, const std::string &key,
+           const std::string &value) {
+  auto [found, stored] = cache.find(key);
+  return found && stored == value;
+}
+
+}  // namespace
+
+int main() {
+  constexpr size_t kWays = 4;
+
+  // Keys sharing a hash each come back with their own value.
+  {
+    Cache cache(kWays, kWays);
+    cache.store("Hello", "Hola");
+    cache.store("Goodbye", "Adiós");
+    check(holds(cache, "Hello", "Hola"), "collision, first");
+    check(holds(cache, "Goodbye", "Adiós"), "collision, second");
+    check(!cache.find("Thanks").first, "collision, absent");
+
+    // Storing a key again replaces its value, in place.
+    cache.store("Hello", "Buenos días");
+    check(holds(cache, "Hello", "Buenos días"), "collision, replaced");
+    check(holds(cache, "Goodbye", "Adiós"), "collision, other kept");
+    check(cache.stats().evictions == 0, "collision, no evictions");
+  }
+
+  // A single set, with one entry hit after every store and the rest never:
+  // CLOCK evicts around the one hit.
+  {
+    Cache cache(kWays, kWays);
+    cache.store("hot", "caliente");
+    for (size_t i = 0; i < 100; i++) {
+      cache.store("cold " + std::to_string(i), "frío");
+      check(holds(cache, "hot", "caliente"), "clock, hot kept");
+    }
+    check(!cache.find("cold 0").first, "clock, cold evicted");
+    check(holds(cache, "cold 99", "frío"), "clock, latest kept");
+
+    Cache::Stats stats = cache.stats();
+    check(stats.evictions == 100 - (kWays - 1), "clock, evictions");
+    check(stats.conflicts == 0, "clock, no conflicts");
+  }
+
+  // Every entry of the set hit since the hand last passed, the store evicts
+  // one of them, which counts as a conflict. Unhit entries do not.
+  {
+    Cache cache(kWays, kWays);
+    for (size_t i = 0; i < kWays; i++) {
+      cache.store("hot " + std::to_string(i), "caliente");
+      cache.find("hot " + std::to_string(i));
+    }
+    cache.store("new", "nuevo");
+    Cache::Stats stats = cache.stats();
+    check(stats.evictions == 1 && stats.conflicts == 1, "conflict, counted");
+
+    cache.store("newer", "más nuevo");
+    stats = cache.stats();
+    check(stats.evictions == 2 && stats.conflicts == 1, "conflict, not cold");
+  }
+
+  std::printf("[%s] cache\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// Checks the vectorized byte scans the splitter runs agree with their scalar
+// twins and with straightforward references, on sequences placed across every
+// offset of a vector width and on random bytes.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "slimt/Scan.hh"
+
+namespace {
+
+using namespace slimt;  // NOLINT
+
+// Decodes code points one at a time, checking the range of each.
+bool reference_utf8(std::string_view text) {
+  size_t i = 0;
+  while (i < text.size()) {
+    auto lead = static_cast<unsigned char>(text[i]);
+    size_t length = 0;
+    uint32_t point = 0;
+    if (lead < 0x80) {
+      length = 1;
+      point = lead;
+    } else if ((lead & 0xE0) == 0xC0) {
+      length = 2;
+      point = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+      length = 3;
+      point = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+      length = 4;
+      point = lead & 0x07;
+    } else {
+      return false;
+    }
+
+    if (i + length > text.size()) {
+      return false;
+    }
+    for (size_t j = 1; j < length; j++) {
+      auto c = static_cast<unsigned char>(text[i + j]);
+      if ((c & 0xC0) != 0x80) {
+        return false;
+      }
+      point = (point << 6) | (c & 0x3F);
+    }
+
+    constexpr uint32_t kSmallest[] = {0, 0, 0x80, 0x800, 0x10000};
+    bool surrogate = point >= 0xD800 && point <= 0xDFFF;
+    if (point < kSmallest[length] || surrogate || point > 0x10FFFF) {
+      return false;
+    }
+    i += length;
+  }
+  return true;
+}
+
+const char *reference_ender(std::string_view text) {
+  size_t first = text.size();
+  for (std::string_view ender : {".", "?", "!", "։", "。", "！", "？"}) {
+    first = std::min(first, std::min(text.find(ender), text.size()));
+  }
+  return text.data() + first;
+}
+
+size_t failures = 0;
+
+void check(bool pass, const std::string &name, std::string_view text) {
+  if (!pass) {
+    ++failures;
+    std::printf("[FAIL] %s on", name.c_str());
+    for (char c : text) {
+      std::printf(" %02x", static_cast<unsigned char>(c));
+    }
+    std::printf("\n");
+  }
+}
+
+void compare(std::string_view text) {
+  const char *begin = text.data();
+  const char *end = begin + text.size();
+  check(scan::next_ender_byte(begin, end) ==
+            scan::scalar::next_ender_byte(begin, end),
+        "next_ender_byte", text);
+  check(scan::next_ender(begin, end) == reference_ender(text), "next_ender",
+        text);
+  check(scan::skip_ascii(begin, end) == scan::scalar::skip_ascii(begin, end),
+        "skip_ascii", text);
+  check(scan::valid_utf8(begin, end) == reference_utf8(text), "valid_utf8",
+        text);
+}
+
+}  // namespace
+
+int main() {
+  // Each placed after every amount of ASCII up to past two AVX2 widths, then
+  // followed by more, so that each straddles every vector boundary.
+  const std::vector<std::string> sequences = {
+      ".",                 // ASCII ender
+      "é",                 // 2 bytes
+      "。",                // 3 byte ender
+      "？",                // 3 byte ender, shares a lead with ！
+      "\xEF\xBC\x80",      // shares that lead, not an ender
+      "\xD6\x89",          // ։
+      "😀",                // 4 bytes
+      "\xF4\x8F\xBF\xBF",  // U+10FFFF
+      "\xC0\xAF",          // overlong
+      "\xE0\x80\xAF",      // overlong
+      "\xED\xA0\x80",      // surrogate
+      "\xF4\x90\x80\x80",  // past U+10FFFF
+      "\xE3\x80",          // truncated
+      "\x80",              // stray continuation
+      "\xFF",              // never valid
+  };
+
+  for (const std::string &sequence : sequences) {
+    for (size_t before = 0; before <= 70; before++) {
+      for (size_t after : {0, 1, 15, 16, 31, 32, 40}) {
+        std::string text(before, 'a');
+        text += sequence;
+        text.append(after, 'b');
+        compare(text);
+
+        // Cut short, so the sequence may run off the end.
+        compare(std::string_view(text).substr(0, before + 1));
+      }
+    }
+  }
+
+  // Random bytes, drawn mostly from those the scans treat specially.
+  const std::string alphabet =
+      "ab .?!\n\t\x80\x89\x82\x81\x9f\xbc\xbf\xa0\x90\xc2\xd6\xe0\xe3\xed\xef"
+      "\xf0\xf4\xff";
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<size_t> length(0, 130);
+  std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+  for (size_t i = 0; i < 100000; i++) {
+    std::string text(length(generator), ' ');
+    for (char &c : text) {
+      c = alphabet[pick(generator)];
+    }
+    compare(text);
+  }
+
+  std::printf("[%s] scan\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// Checks the splitter, which starts the chunker at the next sentence ender a
+// byte scan finds, returns the same sentences as it did when the chunker
+// walked the text from the cursor. The reference below is the splitter as it
+// was, regex prefix lookup included.
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "slimt/Regex.hh"
+#include "slimt/Splitter.hh"
+
+namespace {
+
+using slimt::Match;
+using slimt::Regex;
+
+using Prefixes = std::map<std::string, int, std::less<>>;
+
+int prefix_class(const Prefixes &prefixes, std::string_view piece) {
+  static Regex last_token(".*\\s([^\\s]*)", PCRE2_DOTALL);
+  thread_local static Match match(last_token);
+  if (last_token.consume(&piece, &match, PCRE2_NO_UTF_CHECK) > 0) {
+    piece = match[1];
+  }
+  auto query = prefixes.find(piece);
+  return query == prefixes.end() ? 0 : query->second;
+}
+
+std::string_view reference(const Prefixes &prefixes, std::string_view *rest) {
+  static Regex whitespace_re("\\s*",
+                             PCRE2_UTF | PCRE2_DOTALL | PCRE2_NEWLINE_ANY);
+  static Regex chunker_re(
+      "\\s*"
+      "[^.?!։。？！]*?"
+      "([\\p{L}\\p{Lo}\\p{N}]*)"
+      "([.?!։。？！]++)"
+      "("
+      "['\")\\]’”\\p{Pf}]*"
+      "(?:\\[[\\p{Nd}]+[\\p{Nd},\\s]*[\\p{Nd}]\\])?"
+      "['\")\\]’”\\p{Pf}]*"
+      ")"
+      "(\\s*)"
+      "(?="
+      "([^\\s\\p{L}\\p{Lo}\\p{N}\\p{M}\\p{S}]*)"
+      "\\s*"
+      "([\\p{L}\\p{Lo}\\p{M}\\p{N}]*)"
+      ")",
+      PCRE2_UTF | PCRE2_DOTALL | PCRE2_NEWLINE_ANY);
+  static const Regex lowercase("\\p{M}*\\p{Ll}", PCRE2_NO_UTF_CHECK);
+  static Regex uppercase(R"(\p{M}*[\p{Lu}\p{Lt}])", PCRE2_NO_UTF_CHECK);
+  static Regex digit("[\\p{Nd}\\p{Nl}]", PCRE2_NO_UTF_CHECK);
+  static Regex letterother("\\p{M}*[\\p{Lo}]", PCRE2_NO_UTF_CHECK | PCRE2_UTF);
+
+  thread_local static Match whitespace_m(whitespace_re);
+  thread_local static Match chunker_m(chunker_re);
+  thread_local static Match lowercase_m(lowercase);
+  thread_local static Match uppercase_m(uppercase);
+  thread_local static Match digit_m(digit);
+  thread_local static Match letterother_m(letterother);
+
+  whitespace_re.consume(rest, &whitespace_m, PCRE2_NO_UTF_CHECK);
+  const char *snt_start = rest->data();
+  const char *snt_end = rest->data() + rest->size();
+  int success = 0;
+  while ((success = chunker_re.consume(rest, &chunker_m, PCRE2_NO_UTF_CHECK)) >
+         0) {
+    auto whole_match = chunker_m[0];
+    auto prefix = chunker_m[1];
+    auto punct = chunker_m[2];
+    auto tail = chunker_m[3];
+    auto whitespace_after = chunker_m[4];
+    auto following_symbol = chunker_m[6];
+
+    if (whitespace_after.empty() &&
+        !(punct == "。" || punct == "！" || punct == "？")) {
+      continue;
+    }
+    if (letterother.find(following_symbol, &letterother_m, 0, PCRE2_ANCHORED) >
+        0) {
+    } else if (lowercase.find(following_symbol, &lowercase_m, 0,
+                              PCRE2_ANCHORED) > 0) {
+      continue;
+    } else if (uppercase.find(following_symbol, &uppercase_m, 0,
+                              PCRE2_ANCHORED) > 0) {
+      if (punct == "." && prefix_class(prefixes, prefix) != 0) {
+        continue;
+      }
+      if (punct.size() == 1 && *snt_end == '.') {
+        continue;
+      }
+    } else if (digit.find(following_symbol, &digit_m, 0, PCRE2_ANCHORED) > 0) {
+      if (punct == "." && prefix_class(prefixes, prefix) == 2) {
+        continue;
+      }
+    } else {
+      if (punct == "..." && (punct.data() - whole_match.data() > 1) &&
+          tail == "]" && *(punct.data() - 1) == '[') {
+        continue;
+      }
+    }
+    snt_end = whitespace_after.data();
+    break;
+  }
+
+  std::string_view snt(snt_start, snt_end - snt_start);
+  if (success < 1) {
+    static Regex rtrim("(.*[^\\s])\\s*", PCRE2_NO_UTF_CHECK | PCRE2_DOTALL);
+    thread_local static Match m(rtrim);
+    if (rtrim.consume(&snt, &m, PCRE2_NO_UTF_CHECK) > 0) {
+      snt = m[1];
+    }
+    *rest = std::string_view();
+  }
+  return snt;
+}
+
+size_t failures = 0;
+
+// Splits text to the end both ways, comparing each sentence by position, not
+// only by content.
+void compare(const slimt::Splitter &splitter, const Prefixes &prefixes,
+             std::string_view text) {
+  std::string_view rest = text;
+  std::string_view expected_rest = text;
+  while (true) {
+    std::string_view sentence = splitter(&rest);
+    std::string_view expected = reference(prefixes, &expected_rest);
+    bool same = sentence.data() == expected.data() &&
+                sentence.size() == expected.size() &&
+                rest.size() == expected_rest.size();
+    if (!same) {
+      ++failures;
+      std::printf("[FAIL] splitter on \"%.*s\": \"%.*s\" != \"%.*s\"\n",
+                  static_cast<int>(text.size()), text.data(),
+                  static_cast<int>(sentence.size()), sentence.data(),
+                  static_cast<int>(expected.size()), expected.data());
+      return;
+    }
+    if (sentence.empty() && rest.empty()) {
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  const std::string prefix_file =
+      "Mr\n"
+      "Dr\n"
+      "etc\n"
+      "No #NUMERIC_ONLY#\n"
+      "Art #NUMERIC_ONLY#\n";
+  slimt::Splitter splitter;
+  splitter.load_from_serialized(prefix_file);
+  Prefixes prefixes = {
+      {"Mr", 1}, {"Dr", 1}, {"etc", 1}, {"No", 2}, {"Art", 2}};
+
+  const std::vector<std::string> texts = {
+      // ASCII
+      "Hello world. This is a test! Is it? Yes.",
+      "  Leading space.   And trailing.  ",
+      "No ender at all",
+      "Ends in an ender.",
+      "\"Stop!\" she said. 'Go.' Then (quietly.) Later.",
+      "Wait... What? Really?! Fine.\nNext line. Last",
+      "Lowercase follows. and so no break. Upper Follows.",
+      // Nonbreaking prefixes, numeric only or not, and abbreviations.
+      "Mr. Smith met Dr. Jones. They talked etc. Then left.",
+      "See No. 5 for details. No. More prefixes. Art. 12 applies.",
+      "The U.S.A. Is big. The U.K. is not. A.B. Smith.",
+      "Pi is 3.14 today. Version 2.0. Released.",
+      // CJK with no whitespace, and fullwidth enders.
+      "今天天气很好。我们去公园吧！你来吗？好的。",
+      "東京は大きい。Tokyo is big. 大阪も。",
+      "ＡＢＣ！ＤＥＦ？ＧＨＩ。",
+      // Armenian full stop.
+      "Բարեւ։ Ինչպես ես։ Լավ եմ։",
+      // In-text ellipses.
+      "He said [...] and left. Then [...] Another.",
+      "Quote [...] — then. [...] At the start.",
+      "Trailing [...]",
+      // Footnotes.
+      "As shown before.[1] The next. See 2.[3, 4] And more.",
+      "A claim.[12] Another claim.[1,2,3] Last.",
+  };
+
+  for (const std::string &text : texts) {
+    compare(splitter, prefixes, text);
+  }
+
+  // Random documents, of pieces drawn mostly from what decides boundaries.
+  const std::vector<std::string> pieces = {
+      "word", "Word", "Mr", "No",   "etc", "12", "3",  "今天", "Բարեւ", "é",
+      "Éa",   ".",    "..", "...",  "?",   "!",  "?!", "。",   "！",    "？",
+      "։",    " ",    "  ", "\n",   "\t",  "[",  "]",  "(",    ")",     ",",
+      "\"",   "'",    "”",  "’",    "—",   "-",  "A.", "a.b.", "[...]", "[1]",
+      "[2, 3]"};
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<size_t> length(0, 40);
+  std::uniform_int_distribution<size_t> pick(0, pieces.size() - 1);
+  for (size_t i = 0; i < 20000; i++) {
+    std::string text;
+    for (size_t j = length(generator); j > 0; j--) {
+      text += pieces[pick(generator)];
+    }
+    compare(splitter, prefixes, text);
+  }
+
+  std::printf("[%s] splitter\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+// Checks a thread waiting on a ThreadPool::Group runs queued tasks of that
+// group, and only those.
+
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "slimt/ThreadPool.hh"
+
+int main() {
+  using slimt::ThreadPool;
+  ThreadPool pool(1);
+
+  // Holds the only worker, so that everything after stays queued.
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::future<void> blocker = pool.submit([released]() { released.wait(); });
+
+  std::atomic<bool> foreign_ran = false;
+  std::future<void> foreign =
+      pool.submit([&foreign_ran]() { foreign_ran = true; });
+
+  ThreadPool::Group group;
+  std::vector<std::future<std::thread::id>> futures;
+  for (size_t i = 0; i < 4; i++) {
+    futures.push_back(
+        pool.submit(group, []() { return std::this_thread::get_id(); }));
+  }
+
+  bool pass = true;
+  for (auto &future : futures) {
+    pass = pass && pool.wait(group, future) == std::this_thread::get_id();
+  }
+  pass = pass && !foreign_ran;
+
+  release.set_value();
+  blocker.get();
+  foreign.get();
+  pass = pass && foreign_ran;
+
+  std::printf("[%s] threadpool\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
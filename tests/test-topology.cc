@@ -0,0 +1,90 @@
+// Checks sysfs CPU lists parse, and that place spreads workers over nodes
+// round-robin, then over the cores or cache domains of each node, on a
+// synthetic topology rather than the machine's own.
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "slimt/Topology.hh"
+
+namespace {
+
+using slimt::Placement;
+using slimt::Topology;
+
+size_t failures = 0;
+
+void check(bool pass, const std::string &name) {
+  if (!pass) {
+    ++failures;
+    std::printf("[FAIL] %s\n", name.c_str());
+  }
+}
+
+bool placed(const Topology &topology, const std::string &mode, size_t worker,
+            size_t node, const Topology::CPUs &cpus) {
+  Placement placement = slimt::place(topology, mode, worker);
+  return placement.node == node && placement.cpus == cpus;
+}
+
+}  // namespace
+
+int main() {
+  using slimt::parse_cpus;
+
+  // Ranges, single CPUs and both mixed, as sysfs writes them.
+  check(parse_cpus("0-3") == Topology::CPUs{0, 1, 2, 3}, "parse, range");
+  check(parse_cpus("5") == Topology::CPUs{5}, "parse, single");
+  check(parse_cpus("0-3,8,10-11") == Topology::CPUs{0, 1, 2, 3, 8, 10, 11},
+        "parse, mixed");
+  check(parse_cpus("7-7") == Topology::CPUs{7}, "parse, range of one");
+
+  // Empty lists, as of a node without CPUs, and blank or malformed entries.
+  check(parse_cpus("").empty(), "parse, empty");
+  check(parse_cpus(",").empty(), "parse, only comma");
+  check(parse_cpus("0-1,,4") == Topology::CPUs{0, 1, 4}, "parse, blank entry");
+  check(parse_cpus("x,2") == Topology::CPUs{2}, "parse, malformed entry");
+
+  // Two nodes of four CPUs, each two caches of two CPUs.
+  Topology topology{
+      .nodes = {{0, 1, 2, 3}, {4, 5, 6, 7}},       //
+      .caches = {{0, 1}, {2, 3}, {4, 5}, {6, 7}},  //
+  };
+  check(topology.node(5) == 1, "node, found");
+  check(topology.node(99) == 0, "node, unknown");
+
+  // One core each, alternating nodes, wrapping once every core has one.
+  check(placed(topology, "core", 0, 0, {0}), "core, first");
+  check(placed(topology, "core", 1, 1, {4}), "core, second node");
+  check(placed(topology, "core", 2, 0, {1}), "core, next core");
+  check(placed(topology, "core", 7, 1, {7}), "core, last");
+  check(placed(topology, "core", 8, 0, {0}), "core, wraps");
+
+  // One cache domain each, of the worker's own node.
+  check(placed(topology, "cache", 0, 0, {0, 1}), "cache, first");
+  check(placed(topology, "cache", 1, 1, {4, 5}), "cache, second node");
+  check(placed(topology, "cache", 2, 0, {2, 3}), "cache, next cache");
+  check(placed(topology, "cache", 3, 1, {6, 7}), "cache, last");
+  check(placed(topology, "cache", 4, 0, {0, 1}), "cache, wraps");
+
+  // The whole node.
+  check(placed(topology, "node", 0, 0, {0, 1, 2, 3}), "node, first");
+  check(placed(topology, "node", 1, 1, {4, 5, 6, 7}), "node, second");
+  check(placed(topology, "node", 2, 0, {0, 1, 2, 3}), "node, wraps");
+
+  // No mode, no pinning, and every worker on the first node.
+  check(placed(topology, "", 1, 0, {}), "none");
+  check(placed(topology, "socket", 3, 0, {}), "none, unknown mode");
+
+  // A node no cache domain starts in makes one domain of its own.
+  Topology uncached{
+      .nodes = {{0, 1}, {2, 3}},  //
+      .caches = {{0, 1}},         //
+  };
+  check(placed(uncached, "cache", 0, 0, {0, 1}), "cache, listed");
+  check(placed(uncached, "cache", 1, 1, {2, 3}), "cache, unlisted node");
+
+  std::printf("[%s] topology\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}